@@ -0,0 +1,209 @@
+// Measures the resident memory a server holds for each idle connection.
+//
+// For each websocketpp server config a server process is forked, which in
+// turn forks a client process opening the given number of connections with a
+// client_pool. Each connection sends one message, as a player sends its JWT,
+// and then stays open and idle. Once every connection is open the growth of
+// the server's VmRSS is divided by the number of connections and scaled to
+// 100k connections. Pages of a read buffer only become resident once a read
+// reaches them, so each config is measured twice: with players idle after
+// sending their JWT, and with players idle after each sending one message of
+// 16KB, as a player active earlier in the lobby would have. The configs
+// compared are
+//
+//   - asio_no_logs, whose connections each hold a 16KB read buffer inline,
+//   - asio_low_memory, whose connections wait for the socket to be readable
+//     before borrowing a read buffer from a shared pool.
+//
+// Each connection takes a file descriptor in both the server and the client
+// process, so the number of connections is limited by ulimit -n.
+//
+// Usage: ./connection_memory_bench [connections, default 10000] [port]
+
+#include <simple_web_game_server/client_pool.hpp>
+
+#include <websocketpp/server.hpp>
+#include <websocketpp_configs/asio_no_logs.hpp>
+#include <websocketpp_configs/asio_low_memory.hpp>
+#include <websocketpp_configs/asio_client_no_logs.hpp>
+
+#include <malloc.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <thread>
+
+namespace {
+  using namespace std::chrono_literals;
+
+  // returns the resident set size of this process in kB
+  long get_rss_kb() {
+    std::ifstream status{"/proc/self/status"};
+    std::string line;
+    while(std::getline(status, line)) {
+      if(line.compare(0, 6, "VmRSS:") == 0) {
+        return std::stol(line.substr(6));
+      }
+    }
+    return 0;
+  }
+
+  // opens the given number of connections and keeps them open until killed
+  void run_clients(std::size_t connections, unsigned short port,
+    std::size_t message_size)
+  {
+    using client_pool = simple_web_game_server::client_pool<
+        asio_client_no_logs
+      >;
+
+    std::string uri = "ws://localhost:" + std::to_string(port);
+    client_pool pool;
+    std::string message(message_size, 'x');
+    for(std::size_t i = 0; i < connections; i++) {
+      // connections are only added here, so the id of each is i
+      pool.connect(uri, "player " + std::to_string(i),
+        [&pool, &message, i]() {
+          if(!message.empty()) {
+            pool.send(i, message);
+          }
+        }
+      );
+    }
+    pool.run();
+  }
+
+  template<typename server_config>
+  int run_server(const char* name, std::size_t connections,
+    unsigned short port, std::size_t message_size)
+  {
+    using ws_server = websocketpp::server<server_config>;
+    using message_ptr = typename ws_server::message_ptr;
+    using connection_hdl = websocketpp::connection_hdl;
+
+    std::atomic<std::size_t> open_count{ 0 };
+    std::atomic<std::size_t> message_count{ 0 };
+
+    ws_server server;
+    server.init_asio();
+    server.set_reuse_addr(true);
+    server.set_listen_backlog(4096);
+    server.set_open_handler([&](connection_hdl) { ++open_count; });
+    server.set_close_handler([&](connection_hdl) { --open_count; });
+    server.set_message_handler(
+        [&](connection_hdl, message_ptr) { ++message_count; }
+      );
+    server.listen(port);
+    server.start_accept();
+
+    // fork the clients before the server starts any threads
+    pid_t client_pid = fork();
+    if(client_pid < 0) {
+      std::perror("fork");
+      return 1;
+    } else if(client_pid == 0) {
+      run_clients(connections, port, message_size);
+      std::_Exit(0);
+    }
+
+    std::thread server_thr{[&server]() { server.run(); }};
+
+    std::this_thread::sleep_for(100ms);
+    long base_rss = get_rss_kb();
+
+    std::size_t expected_messages = message_size > 0
+      ? 2 * connections : connections;
+    auto start = std::chrono::steady_clock::now();
+    while(message_count < expected_messages
+      && std::chrono::steady_clock::now() - start < 120s)
+    {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(500ms);
+
+    // hand heap pages freed after the messages were read back to the system,
+    // so that only memory still held by the connections is counted
+    malloc_trim(0);
+    long rss = get_rss_kb();
+    std::size_t open = open_count;
+
+    kill(client_pid, SIGKILL);
+    waitpid(client_pid, nullptr, 0);
+
+    double per_connection = open > 0
+      ? 1024.0 * (rss - base_rss) / open : 0;
+    std::printf("%-16s %8zu %11zu %12ld %12ld %12.0f %13.1f\n", name,
+      message_size, open, base_rss, rss, per_connection, per_connection * 100000 / (1 << 20));
+    std::fflush(stdout);
+
+    server.stop_listening();
+    server.stop();
+    server_thr.join();
+
+    return open == connections ? 0 : 2;
+  }
+
+  // runs the server in its own process, so that each config starts with the
+  // same heap
+  template<typename server_config>
+  int measure(const char* name, std::size_t connections, unsigned short port,
+    std::size_t message_size)
+  {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0) {
+      std::perror("fork");
+      return 1;
+    } else if(pid == 0) {
+      std::_Exit(
+          run_server<server_config>(name, connections, port, message_size)
+        );
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t connections = 10000;
+  unsigned short port = 9095;
+  if(argc > 1) {
+    connections = std::strtoul(argv[1], nullptr, 10);
+  }
+  if(argc > 2) {
+    port = static_cast<unsigned short>(std::strtoul(argv[2], nullptr, 10));
+  }
+
+  std::printf("%zu idle connections\n\n", connections);
+  std::printf("%-16s %8s %11s %12s %12s %12s %13s\n", "config",
+    "message", "connections", "base kB", "rss kB", "bytes/conn",
+    "MB per 100k");
+
+  int result = 0;
+  for(std::size_t message_size : { std::size_t{0}, std::size_t{16384} }) {
+    result |= measure<asio_no_logs>(
+        "asio_no_logs", connections, port, message_size
+      );
+    result |= measure<asio_low_memory>(
+        "asio_low_memory", connections, port, message_size
+      );
+  }
+
+  if(result != 0) {
+    std::printf("\nnot every connection opened, try a lower count or a "
+      "higher ulimit -n\n");
+    return 2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,384 @@
+// Drives matchmakers directly with a synthetic population of sessions.
+//
+// No server or websockets are involved: each simulated tick the sessions
+// arriving in that tick join the matchmaker, sessions that have run out of
+// patience leave it, and match() is called as the matchmaking_server would.
+// Arrivals are a Poisson process, ratings are normally distributed, and each
+// session has an exponentially distributed patience. Every matchmaker is run
+// on the same population at a low and a high arrival rate, reporting
+//
+//   - the simulated time sessions waited before being matched,
+//   - the fraction of sessions matched and the fraction that gave up,
+//   - the CPU time spent in the matchmaker each tick, and the wall time of
+//     each call to match(),
+//   - heap allocations made by the matchmaker per tick, counted by replacing
+//     operator new,
+//   - the rating spread within games and the share of games mixing regions.
+//
+// Usage: ./matchmaker_bench [seconds simulated, default 120]
+
+#include <simple_web_game_server/matchmaker_traits.hpp>
+#include <simple_web_game_server/latency_histogram.hpp>
+#include <simple_web_game_server/min_cost_matchmaker.hpp>
+#include <simple_web_game_server/party_matchmaker.hpp>
+#include <simple_web_game_server/rating_matchmaker.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+  std::atomic<std::size_t> allocation_count{ 0 };
+}
+
+void* operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if(void* ptr = std::malloc(size > 0 ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+using json = nlohmann::json;
+using simple_web_game_server::is_incremental_matchmaker;
+using simple_web_game_server::latency_histogram;
+using clock_type = std::chrono::steady_clock;
+
+struct bench_player_traits {
+  struct id {
+    using player_id = unsigned long;
+    using session_id = unsigned long;
+    using hash = std::hash<unsigned long>;
+  };
+};
+
+// the shape of the simulated player population
+struct population {
+  // sessions arriving per second
+  double arrival_rate;
+  // mean seconds an unmatched session waits before leaving
+  double mean_patience;
+  double rating_mean;
+  double rating_deviation;
+  std::vector<std::string> regions;
+  // relative frequency of parties of size 1, 2, ...
+  std::vector<double> party_weights;
+};
+
+// a session of the population, generated once and replayed for each
+// matchmaker so that all of them see exactly the same arrivals
+struct arrival {
+  unsigned long sid;
+  long join_time;
+  long leave_time;
+  double rating;
+  std::size_t region;
+  json data;
+};
+
+std::vector<std::vector<arrival> > generate_arrivals(
+    const population& pop,
+    std::size_t ticks,
+    long tick_ms,
+    unsigned long seed
+  )
+{
+  std::mt19937_64 rng{ seed };
+  std::poisson_distribution<std::size_t> count_dist{
+    pop.arrival_rate * tick_ms / 1000.0
+  };
+  std::normal_distribution<double> rating_dist{
+    pop.rating_mean, pop.rating_deviation
+  };
+  std::exponential_distribution<double> patience_dist{
+    1.0 / pop.mean_patience
+  };
+  std::uniform_int_distribution<std::size_t> region_dist{
+    0, pop.regions.size() - 1
+  };
+  std::discrete_distribution<int> party_dist{
+    pop.party_weights.begin(), pop.party_weights.end()
+  };
+
+  std::vector<std::vector<arrival> > arrivals(ticks);
+  unsigned long sid_count = 0;
+  for(std::size_t t = 0; t < ticks; ++t) {
+    const long now = static_cast<long>(t) * tick_ms;
+    const std::size_t count = count_dist(rng);
+    for(std::size_t i = 0; i < count; ++i) {
+      arrival a;
+      a.sid = sid_count++;
+      a.join_time = now;
+      a.leave_time = now + static_cast<long>(1000.0 * patience_dist(rng));
+      a.rating = rating_dist(rng);
+      a.region = region_dist(rng);
+      a.data["rating"] = a.rating;
+      a.data["region"] = pop.regions[a.region];
+      a.data["party_size"] = party_dist(rng) + 1;
+      arrivals[t].push_back(std::move(a));
+    }
+  }
+
+  return arrivals;
+}
+
+long thread_cpu_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+double percentile(std::vector<double>& values, double p) {
+  if(values.empty()) {
+    return 0;
+  }
+  const std::size_t i = static_cast<std::size_t>(
+      p / 100.0 * (values.size() - 1)
+    );
+  std::nth_element(values.begin(), values.begin() + i, values.end());
+  return values[i];
+}
+
+template<typename matchmaker>
+void run_bench(
+    const char* name,
+    const std::vector<std::vector<arrival> >& arrivals,
+    long tick_ms
+  )
+{
+  using session_id = typename matchmaker::session_id;
+  using session_data = typename matchmaker::session_data;
+  using leave_event = std::pair<long, session_id>;
+
+  matchmaker mm;
+  std::vector<typename matchmaker::game> games;
+  std::vector<typename matchmaker::message> messages;
+
+  // the queued sessions, as given to matchmakers without their own index
+  std::unordered_map<
+      session_id,
+      session_data,
+      typename bench_player_traits::id::hash
+    > sessions;
+  std::unordered_map<session_id, const arrival*> queued;
+  std::priority_queue<
+      leave_event,
+      std::vector<leave_event>,
+      std::greater<leave_event>
+    > leave_events;
+
+  latency_histogram wait_times;
+  latency_histogram tick_times;
+  latency_histogram match_times;
+  std::vector<double> spreads;
+  std::size_t arrival_count = 0;
+  std::size_t matched_count = 0;
+  std::size_t abandoned_count = 0;
+  std::size_t game_count = 0;
+  std::size_t mixed_region_count = 0;
+  std::size_t allocations = 0;
+  long tick_cpu = 0;
+
+  // only time spent, and memory allocated, inside the matchmaker is counted
+  auto measure = [&](auto&& f) {
+    const std::size_t allocations_start = allocation_count.load();
+    const long cpu_start = thread_cpu_ns();
+    f();
+    tick_cpu += thread_cpu_ns() - cpu_start;
+    allocations += allocation_count.load() - allocations_start;
+  };
+
+  for(std::size_t t = 0; t < arrivals.size(); ++t) {
+    const long now = static_cast<long>(t) * tick_ms;
+    tick_cpu = 0;
+
+    for(const arrival& a : arrivals[t]) {
+      session_data data{ a.data };
+      if(!data.is_valid()) {
+        continue;
+      }
+      ++arrival_count;
+      queued.emplace(a.sid, &a);
+      leave_events.emplace(a.leave_time, a.sid);
+      auto it = sessions.emplace(a.sid, std::move(data)).first;
+      if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+        measure([&]() { mm.on_join(it->first, it->second); });
+      }
+    }
+
+    while(!leave_events.empty() && leave_events.top().first <= now) {
+      const session_id sid = leave_events.top().second;
+      leave_events.pop();
+      if(queued.erase(sid) > 0) {
+        ++abandoned_count;
+        if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+          measure([&]() { mm.on_leave(sid); });
+        }
+        sessions.erase(sid);
+      }
+    }
+
+    games.clear();
+    messages.clear();
+    const auto match_start = clock_type::now();
+    measure([&]() {
+        if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+          if(mm.can_match()) {
+            mm.match(games, messages, tick_ms);
+          }
+        } else {
+          if(mm.can_match(sessions)) {
+            mm.match(games, messages, sessions, tick_ms);
+          }
+        }
+      });
+    match_times.record(clock_type::now() - match_start);
+    tick_times.record(std::chrono::nanoseconds{ tick_cpu });
+
+    for(const auto& g : games) {
+      double min_rating = 0;
+      double max_rating = 0;
+      std::size_t first_region = 0;
+      bool is_mixed = false;
+      bool is_first = true;
+
+      for(const session_id& sid : std::get<0>(g)) {
+        auto it = queued.find(sid);
+        if(it == queued.end()) {
+          std::printf("%s matched unknown session %lu\n", name, sid);
+          std::exit(1);
+        }
+        const arrival& a = *it->second;
+        wait_times.record(std::chrono::milliseconds{ now - a.join_time });
+
+        if(is_first) {
+          min_rating = max_rating = a.rating;
+          first_region = a.region;
+          is_first = false;
+        }
+        min_rating = std::min(min_rating, a.rating);
+        max_rating = std::max(max_rating, a.rating);
+        is_mixed = is_mixed || a.region != first_region;
+
+        queued.erase(it);
+        sessions.erase(sid);
+        ++matched_count;
+      }
+
+      spreads.push_back(max_rating - min_rating);
+      mixed_region_count += is_mixed ? 1 : 0;
+      ++game_count;
+    }
+  }
+
+  auto ms = [](const latency_histogram& h, double p) {
+    return static_cast<double>(h.percentile(p).count()) / 1000.0;
+  };
+  auto us = [](const latency_histogram& h, double p) {
+    return static_cast<long long>(h.percentile(p).count());
+  };
+  const double total = static_cast<double>(std::max<std::size_t>(
+      arrival_count, 1
+    ));
+
+  std::printf("%s\n", name);
+  std::printf(
+      "  sessions %zu: matched %.1f%%, gave up %.1f%%, still queued %zu\n",
+      arrival_count,
+      100.0 * matched_count / total,
+      100.0 * abandoned_count / total,
+      queued.size()
+    );
+  std::printf(
+      "  wait       p50=%8.1fms p90=%8.1fms p99=%8.1fms\n",
+      ms(wait_times, 50),
+      ms(wait_times, 90),
+      ms(wait_times, 99)
+    );
+  std::printf(
+      "  tick cpu   p50=%8lldus p99=%8lldus max=%8lldus\n",
+      us(tick_times, 50),
+      us(tick_times, 99),
+      static_cast<long long>(tick_times.max().count())
+    );
+  std::printf(
+      "  match wall p50=%8lldus p99=%8lldus max=%8lldus\n",
+      us(match_times, 50),
+      us(match_times, 99),
+      static_cast<long long>(match_times.max().count())
+    );
+  std::printf(
+      "  allocations per tick %.1f\n",
+      static_cast<double>(allocations) / arrivals.size()
+    );
+  std::printf(
+      "  games %zu: rating spread p50=%.0f p99=%.0f, mixed regions %.1f%%\n",
+      game_count,
+      percentile(spreads, 50),
+      percentile(spreads, 99),
+      100.0 * mixed_region_count / std::max<std::size_t>(game_count, 1)
+    );
+}
+
+int main(int argc, char** argv) {
+  using rating_mm = simple_web_game_server::rating_matchmaker<
+      bench_player_traits,
+      json
+    >;
+  using min_cost_mm = simple_web_game_server::min_cost_matchmaker<
+      bench_player_traits,
+      json
+    >;
+  using party_mm = simple_web_game_server::party_matchmaker<
+      bench_player_traits,
+      json
+    >;
+
+  constexpr long tick_ms = 50;
+  const long seconds = argc > 1 ? std::atol(argv[1]) : 120;
+  const std::size_t ticks = static_cast<std::size_t>(
+      seconds * 1000 / tick_ms
+    );
+
+  population solo{
+    0, 60, 1500, 300, { "na", "eu", "asia", "oce" }, { 1 }
+  };
+  population parties{
+    0, 60, 1500, 300, { "na", "eu", "asia", "oce" }, { 50, 25, 12, 8 }
+  };
+
+  for(double rate : { 20.0, 500.0 }) {
+    std::printf("== %.0f arrivals per second, %lds simulated\n", rate, seconds);
+
+    solo.arrival_rate = rate;
+    const auto solo_arrivals = generate_arrivals(solo, ticks, tick_ms, 12345);
+    run_bench<rating_mm>("rating_matchmaker", solo_arrivals, tick_ms);
+    run_bench<min_cost_mm>("min_cost_matchmaker", solo_arrivals, tick_ms);
+
+    parties.arrival_rate = rate;
+    const auto party_arrivals = generate_arrivals(
+        parties, ticks, tick_ms, 12345
+      );
+    run_bench<party_mm>("party_matchmaker", party_arrivals, tick_ms);
+  }
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Measures min_cost_matchmaker solve times with pools of 1k and 10k sessions.
+//
+// The queue is held at the pool size: every tick as many new sessions join
+// as were matched in the last one. Reports the time taken to solve the first
+// tick, with no warm started prices, and each later tick.
+
+#include <simple_web_game_server/min_cost_matchmaker.hpp>
+#include <simple_web_game_server/latency_histogram.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using simple_web_game_server::default_matching_traits;
+using simple_web_game_server::latency_histogram;
+using simple_web_game_server::min_cost_matchmaker;
+
+struct bench_player_traits {
+  struct id {
+    using player_id = unsigned long;
+    using session_id = unsigned long;
+    using hash = std::hash<unsigned long>;
+  };
+};
+
+template<std::size_t pool>
+struct bench_matching_traits : public default_matching_traits {
+  static constexpr std::size_t pool_size() { return pool; }
+};
+
+constexpr std::size_t ticks = 200;
+constexpr long tick_ms = 50;
+
+template<std::size_t pool>
+void run_bench() {
+  using matchmaker = min_cost_matchmaker<
+      bench_player_traits,
+      json,
+      bench_matching_traits<pool>
+    >;
+
+  std::mt19937_64 rng{ 12345 };
+  std::normal_distribution<double> rating_dist{ 1500, 300 };
+  std::uniform_int_distribution<int> region_dist{ 0, 3 };
+  const std::string regions[] = { "na", "eu", "asia", "oce" };
+
+  matchmaker mm;
+  std::vector<typename matchmaker::game> games;
+  std::vector<typename matchmaker::message> messages;
+  unsigned long sid_count = 0;
+  std::size_t game_count = 0;
+
+  auto join = [&]() {
+    json data;
+    data["rating"] = rating_dist(rng);
+    data["region"] = regions[region_dist(rng)];
+    mm.on_join(sid_count++, typename matchmaker::session_data{ data });
+  };
+
+  for(std::size_t i = 0; i < pool; ++i) {
+    join();
+  }
+
+  latency_histogram first_tick;
+  for(std::size_t t = 0; t < ticks; ++t) {
+    games.clear();
+    mm.match(games, messages, tick_ms);
+    game_count += games.size();
+
+    if(t == 0) {
+      first_tick.merge(mm.get_solve_time_histogram());
+    }
+    while(mm.size() < pool) {
+      join();
+    }
+  }
+
+  const latency_histogram& solve_times = mm.get_solve_time_histogram();
+  std::printf(
+      "pool %5zu: first tick %6lldus, later ticks p50=%6lldus p99=%6lldus "
+      "max=%6lldus, %.1f games per tick\n",
+      pool,
+      static_cast<long long>(first_tick.max().count()),
+      static_cast<long long>(solve_times.percentile(50).count()),
+      static_cast<long long>(solve_times.percentile(99).count()),
+      static_cast<long long>(solve_times.max().count()),
+      static_cast<double>(game_count) / ticks
+    );
+}
+
+int main() {
+  run_bench<1000>();
+  run_bench<10000>();
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Measures party_matchmaker with thousands of parties in queue.
+//
+// Parties of random size join in bursts and are packed into 5v5 games.
+// Reports the time taken by each call to match() and the time per game.
+
+#include <simple_web_game_server/party_matchmaker.hpp>
+#include <simple_web_game_server/latency_histogram.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+using json = nlohmann::json;
+using simple_web_game_server::latency_histogram;
+using simple_web_game_server::party_matchmaker;
+
+struct bench_player_traits {
+  struct id {
+    using player_id = unsigned long;
+    using session_id = unsigned long;
+    using hash = std::hash<unsigned long>;
+  };
+};
+
+struct bench_party_traits {
+  static constexpr std::size_t team_size() { return 5; }
+  static constexpr std::size_t team_count() { return 2; }
+
+  template<typename json_type>
+  static std::size_t get_party_size(const json_type& data) {
+    return data.value("party_size", 1);
+  }
+};
+
+using matchmaker = party_matchmaker<
+    bench_player_traits,
+    json,
+    bench_party_traits
+  >;
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t ticks = 1000;
+constexpr std::size_t joins_per_tick = 5000;
+constexpr long tick_ms = 50;
+
+int main() {
+  std::mt19937_64 rng{ 12345 };
+  // mostly solo players, with fewer parties the larger they are
+  std::discrete_distribution<int> size_dist{ 0, 50, 25, 12, 8, 5 };
+
+  matchmaker mm;
+  std::vector<matchmaker::game> games;
+  std::vector<matchmaker::message> messages;
+
+  latency_histogram match_times;
+  std::size_t game_count = 0;
+  std::size_t max_queue = 0;
+  unsigned long sid_count = 0;
+
+  for(std::size_t t = 0; t < ticks; ++t) {
+    for(std::size_t i = 0; i < joins_per_tick; ++i) {
+      json data;
+      data["party_size"] = size_dist(rng);
+      mm.on_join(sid_count++, matchmaker::session_data{ data });
+    }
+    max_queue = std::max(max_queue, mm.size());
+
+    games.clear();
+    auto start = clock_type::now();
+    mm.match(games, messages, tick_ms);
+    match_times.record(clock_type::now() - start);
+    game_count += games.size();
+  }
+
+  std::printf(
+      "ran %zu ticks, formed %zu games, max queue %zu parties, "
+      "final queue %zu parties\n",
+      ticks,
+      game_count,
+      max_queue,
+      mm.size()
+    );
+  std::printf(
+      "match      mean=%6lldus p50=%6lldus p99=%6lldus max=%6lldus "
+      "per game=%.2fus\n",
+      static_cast<long long>(match_times.mean().count()),
+      static_cast<long long>(match_times.percentile(50).count()),
+      static_cast<long long>(match_times.percentile(99).count()),
+      static_cast<long long>(match_times.max().count()),
+      static_cast<double>(match_times.mean().count()) * ticks / game_count
+    );
+
+  return 0;
+}
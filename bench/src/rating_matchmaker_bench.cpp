@@ -0,0 +1,161 @@
+// Measures rating_matchmaker with a queue held at 100k sessions.
+//
+// The rating window is narrowed so that most queued sessions can not be
+// matched and the queue stays large, while a steady stream of joins and
+// leaves exercises the index. Reports the time taken by each call to
+// match() and the average cost of on_join() and on_leave().
+
+#include <simple_web_game_server/rating_matchmaker.hpp>
+#include <simple_web_game_server/latency_histogram.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+using json = nlohmann::json;
+using simple_web_game_server::latency_histogram;
+using simple_web_game_server::rating_matchmaker;
+
+struct bench_player_traits {
+  struct id {
+    using player_id = unsigned long;
+    using session_id = unsigned long;
+    using hash = std::hash<unsigned long>;
+  };
+};
+
+struct bench_rating_traits {
+  static constexpr double initial_window() { return 0.5; }
+  static constexpr double window_growth() { return 0.5; }
+  static constexpr double max_window() { return 4.0; }
+
+  template<typename json_type>
+  static double get_rating(const json_type& data) {
+    return data.at("rating").template get<double>();
+  }
+};
+
+using matchmaker = rating_matchmaker<
+    bench_player_traits,
+    json,
+    bench_rating_traits
+  >;
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t queue_size = 100000;
+constexpr std::size_t ticks = 1000;
+constexpr std::size_t joins_per_tick = 200;
+constexpr long tick_ms = 50;
+
+int main() {
+  std::mt19937_64 rng{ 12345 };
+  std::uniform_real_distribution<double> rating_dist{ 0, 10000000 };
+
+  matchmaker mm;
+  std::vector<matchmaker::game> games;
+  std::vector<matchmaker::message> messages;
+
+  // queued session ids, with matched sessions removed lazily
+  std::vector<unsigned long> queued;
+  std::vector<char> is_queued;
+  unsigned long sid_count = 0;
+
+  latency_histogram join_times;
+  latency_histogram leave_times;
+  latency_histogram match_times;
+  std::size_t matched_sessions = 0;
+
+  auto join = [&]() {
+    json data;
+    data["rating"] = rating_dist(rng);
+    matchmaker::session_data d{ data };
+
+    const unsigned long sid = sid_count++;
+    auto start = clock_type::now();
+    mm.on_join(sid, d);
+    join_times.record(clock_type::now() - start);
+
+    queued.push_back(sid);
+    is_queued.push_back(1);
+  };
+
+  auto leave = [&]() {
+    while(!queued.empty()) {
+      std::uniform_int_distribution<std::size_t> index_dist{
+        0, queued.size() - 1
+      };
+      const std::size_t i = index_dist(rng);
+      const unsigned long sid = queued[i];
+      queued[i] = queued.back();
+      queued.pop_back();
+
+      if(is_queued[sid]) {
+        auto start = clock_type::now();
+        mm.on_leave(sid);
+        leave_times.record(clock_type::now() - start);
+        is_queued[sid] = 0;
+        return;
+      }
+    }
+  };
+
+  auto fill_start = clock_type::now();
+  for(std::size_t i = 0; i < queue_size; ++i) {
+    join();
+  }
+  const auto fill_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      clock_type::now() - fill_start
+    );
+
+  for(std::size_t t = 0; t < ticks; ++t) {
+    for(std::size_t i = 0; i < joins_per_tick; ++i) {
+      join();
+    }
+    while(mm.size() > queue_size) {
+      leave();
+    }
+
+    games.clear();
+    auto start = clock_type::now();
+    mm.match(games, messages, tick_ms);
+    match_times.record(clock_type::now() - start);
+
+    for(auto& g : games) {
+      for(unsigned long sid : std::get<0>(g)) {
+        is_queued[sid] = 0;
+        ++matched_sessions;
+      }
+    }
+  }
+
+  auto print = [](const char* name, const latency_histogram& h) {
+    std::printf(
+        "%-10s n=%-9llu mean=%6lldus p50=%6lldus p99=%6lldus max=%6lldus\n",
+        name,
+        static_cast<unsigned long long>(h.count()),
+        static_cast<long long>(h.mean().count()),
+        static_cast<long long>(h.percentile(50).count()),
+        static_cast<long long>(h.percentile(99).count()),
+        static_cast<long long>(h.max().count())
+      );
+  };
+
+  std::printf(
+      "filled %zu sessions in %lldms, ran %zu ticks, matched %zu sessions, "
+      "final queue %zu\n",
+      queue_size,
+      static_cast<long long>(fill_time.count()),
+      ticks,
+      matched_sessions,
+      mm.size()
+    );
+  print("match", match_times);
+  print("on_join", join_times);
+  print("on_leave", leave_times);
+
+  return 0;
+}
@@ -0,0 +1,258 @@
+// Measures how fast incoming masked text frames become message payloads, as
+// on a server's receive path.
+//
+// Streams of masked JSON payloads are generated once, either pure ASCII or
+// with some accented names and emoji. Each stream is copied a 16KB read at a
+// time into a read buffer, as the socket would fill it, and each finished
+// payload is moved out, as base_server moves it into an action. The payload
+// step is timed two ways:
+//
+//   - three sweeps, as the hybi13 processor used to: unmask the read in
+//     place, append it to the payload, then validate the appended bytes,
+//   - one sweep with unmask_validate_append, which the processor now uses,
+//     unmasking each read into an L1 resident chunk, validating ASCII
+//     blocks in registers, and appending the chunk to the payload.
+//
+// Finally whole frame streams are fed to the processor's consume(), to show
+// the throughput of the full receive path including header parsing.
+//
+// Usage: ./receive_path_bench [MB of payload per case, default 128]
+
+#include <websocketpp/config/core.hpp>
+#include <websocketpp/frame.hpp>
+#include <websocketpp/processors/hybi13.hpp>
+#include <websocketpp/utf8_validator.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+namespace frame = websocketpp::frame;
+using websocketpp::utf8_validator::validator;
+
+namespace {
+  constexpr std::size_t read_buffer_size = 16384;
+
+  const char* names[] = { "Zoë", "José", "Łukasz", "\xf0\x9f\x8e\xae" };
+
+  std::string make_json(std::size_t size, bool mixed, std::mt19937& rng) {
+    std::uniform_int_distribution<int> coord{ -5000, 5000 };
+    std::uniform_int_distribution<int> pick{ 0, 15 };
+    std::string out = "{\"type\":\"input\",\"moves\":[";
+    while(out.size() + 2 < size) {
+      out += "{\"x\":" + std::to_string(coord(rng)) + ",\"y\":"
+        + std::to_string(coord(rng));
+      int p = pick(rng);
+      if(mixed && p < 4) {
+        out += std::string{",\"by\":\""} + names[p] + "\"";
+      }
+      out += "},";
+    }
+    // cut at a character boundary
+    std::size_t end = size - 2;
+    while(end > 0 && (static_cast<unsigned char>(out[end]) & 0xc0) == 0x80) {
+      --end;
+    }
+    out.resize(end);
+    out += "]}";
+    return out;
+  }
+
+  struct masked_payload {
+    std::string bytes;
+    frame::masking_key_type key;
+  };
+
+  std::vector<masked_payload> make_payloads(std::size_t size, bool mixed,
+    std::size_t total_bytes)
+  {
+    std::mt19937 rng{ 11 };
+    std::vector<masked_payload> payloads;
+    std::size_t bytes = 0;
+    while(bytes < total_bytes) {
+      masked_payload p;
+      p.bytes = make_json(size, mixed, rng);
+      p.key.i = rng();
+      frame::byte_mask_circ(reinterpret_cast<uint8_t*>(&p.bytes[0]),
+        p.bytes.size(), frame::prepare_masking_key(p.key));
+      bytes += p.bytes.size();
+      payloads.push_back(std::move(p));
+    }
+    return payloads;
+  }
+
+  bool three_sweeps(uint8_t* buf, std::size_t len, std::size_t& key,
+    validator& v, std::string& out)
+  {
+    key = frame::vector_mask_circ(buf, len, key);
+    std::size_t offset = out.size();
+    out.append(reinterpret_cast<char*>(buf), len);
+    return v.decode(out.data() + offset, out.data() + out.size());
+  }
+
+  bool one_sweep(uint8_t* buf, std::size_t len, std::size_t& key,
+    validator& v, std::string& out)
+  {
+    return websocketpp::processor::unmask_validate_append(buf, len, key, &v,
+      out);
+  }
+
+  template<typename payload_function>
+  double time_payload_step(const std::vector<masked_payload>& payloads,
+    payload_function process, std::size_t& checksum)
+  {
+    std::vector<uint8_t> buf(read_buffer_size);
+    std::size_t bytes = 0;
+    checksum = 0;
+
+    auto start = clock_type::now();
+    for(const masked_payload& p : payloads) {
+      std::string out;
+      out.reserve(p.bytes.size());
+      validator v;
+      std::size_t key = frame::prepare_masking_key(p.key);
+      for(std::size_t pos = 0; pos < p.bytes.size(); pos += read_buffer_size) {
+        std::size_t n = std::min(read_buffer_size, p.bytes.size() - pos);
+        std::memcpy(buf.data(), p.bytes.data() + pos, n);
+        if(!process(buf.data(), n, key, v, out)) {
+          std::printf("payload failed validation\n");
+          std::exit(1);
+        }
+      }
+      if(!v.complete()) {
+        std::printf("payload ended mid character\n");
+        std::exit(1);
+      }
+      std::string payload = std::move(out);
+      bytes += payload.size();
+      checksum += static_cast<unsigned char>(payload[payload.size() / 2]);
+    }
+    std::chrono::duration<double> elapsed = clock_type::now() - start;
+    return bytes / elapsed.count() / (1 << 20);
+  }
+
+  // runs both paths over the payloads in reads of random lengths
+  bool check_paths_agree(const std::vector<masked_payload>& payloads) {
+    std::mt19937 rng{ 5 };
+    for(std::size_t i = 0; i < payloads.size() && i < 200; i++) {
+      const masked_payload& p = payloads[i];
+      std::string three_out;
+      std::string one_out;
+      validator three_v;
+      validator one_v;
+      std::size_t three_key = frame::prepare_masking_key(p.key);
+      std::size_t one_key = three_key;
+      std::size_t pos = 0;
+      while(pos < p.bytes.size()) {
+        std::size_t n = std::uniform_int_distribution<std::size_t>{
+          1, std::min(read_buffer_size, p.bytes.size() - pos)
+        }(rng);
+        std::string three_buf = p.bytes.substr(pos, n);
+        std::string one_buf = three_buf;
+        bool three_ok = three_sweeps(
+            reinterpret_cast<uint8_t*>(&three_buf[0]), n, three_key, three_v,
+            three_out
+          );
+        bool one_ok = one_sweep(reinterpret_cast<uint8_t*>(&one_buf[0]), n,
+          one_key, one_v, one_out);
+        if(!three_ok || !one_ok || three_key != one_key) {
+          return false;
+        }
+        pos += n;
+      }
+      if(three_out != one_out || !one_v.complete()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  double time_processor(const std::vector<masked_payload>& payloads) {
+    using config = websocketpp::config::core;
+    using processor = websocketpp::processor::hybi13<config>;
+
+    std::string stream;
+    std::size_t payload_bytes = 0;
+    for(const masked_payload& p : payloads) {
+      frame::basic_header h(frame::opcode::TEXT, p.bytes.size(), true, true);
+      frame::extended_header e(p.bytes.size(), p.key.i);
+      stream += frame::prepare_header(h, e);
+      stream += p.bytes;
+      payload_bytes += p.bytes.size();
+    }
+
+    config::rng_type rng;
+    processor proc(false, true,
+      websocketpp::lib::make_shared<config::con_msg_manager_type>(), rng);
+
+    std::vector<uint8_t> buf(read_buffer_size);
+    std::size_t messages = 0;
+
+    auto start = clock_type::now();
+    for(std::size_t pos = 0; pos < stream.size(); pos += read_buffer_size) {
+      std::size_t n = std::min(read_buffer_size, stream.size() - pos);
+      std::memcpy(buf.data(), stream.data() + pos, n);
+
+      std::size_t consumed = 0;
+      while(consumed < n) {
+        websocketpp::lib::error_code ec;
+        consumed += proc.consume(buf.data() + consumed, n - consumed, ec);
+        if(ec) {
+          std::printf("error processing frames: %s\n", ec.message().c_str());
+          std::exit(1);
+        }
+        if(proc.ready()) {
+          std::string payload = std::move(
+              proc.get_message()->get_raw_payload()
+            );
+          ++messages;
+        }
+      }
+    }
+    std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    if(messages != payloads.size()) {
+      std::printf("processor read %zu of %zu messages\n", messages,
+        payloads.size());
+      std::exit(1);
+    }
+    return payload_bytes / elapsed.count() / (1 << 20);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t megabytes = 128;
+  if(argc > 1) {
+    megabytes = std::strtoul(argv[1], nullptr, 10);
+  }
+
+  std::printf("%-6s %8s %14s %14s %8s %14s\n", "text", "payload",
+    "3 sweeps MB/s", "1 sweep MB/s", "speedup", "consume MB/s");
+
+  for(bool mixed : { false, true }) {
+    for(std::size_t size : { 128, 1024, 8192, 65536 }) {
+      std::vector<masked_payload> payloads = make_payloads(size, mixed,
+        megabytes << 20);
+
+      if(!check_paths_agree(payloads)) {
+        std::printf("payloads differ between the two paths\n");
+        return 1;
+      }
+
+      std::size_t checksum;
+      double three = time_payload_step(payloads, three_sweeps, checksum);
+      double one = time_payload_step(payloads, one_sweep, checksum);
+
+      std::printf("%-6s %8zu %14.0f %14.0f %7.2fx %14.0f\n",
+        mixed ? "mixed" : "ascii", size, three, one, one / three,
+        time_processor(payloads));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,200 @@
+// Compares websocketpp's UTF8 validation of text frame payloads with and
+// without the vectorized ASCII fast path.
+//
+// The byte at a time state machine is what validator::decode runs over a
+// std::string iterator range. The fast path is what it runs over a pointer
+// range, as the hybi13 processor now passes, skipping runs of ASCII with
+// ascii_prefix_length. Payloads are JSON game messages of a few sizes that
+// are
+//
+//   - pure ASCII, like most game traffic,
+//   - ASCII with some player names and chat in accented Latin and emoji,
+//   - mostly CJK chat, where the fast path rarely applies.
+//
+// Before timing, both paths are checked to agree on random valid and invalid
+// inputs fed to the validator in random chunks, as frames arrive.
+//
+// Usage: ./utf8_validator_bench [MB validated per case, default 256]
+
+#include <websocketpp/utf8_validator.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+using websocketpp::utf8_validator::validator;
+
+namespace {
+  const char* latin_names[] = { "Zoë", "José", "Ærøskøbing", "Łukasz",
+    "Müller", "Renée" };
+  const char* emoji[] = { "\xf0\x9f\x8e\xae", "\xf0\x9f\x94\xa5",
+    "\xf0\x9f\x91\x8d" };
+  const char* cjk[] = { "你好", "游戏", "開始", "ゲーム", "勝利", "チーム" };
+
+  enum class text_kind { ascii, mixed, cjk };
+
+  // builds a JSON payload of about the given size
+  std::string make_payload(std::size_t size, text_kind kind,
+    std::mt19937& rng)
+  {
+    std::uniform_int_distribution<int> coord{ -5000, 5000 };
+    std::uniform_int_distribution<int> pick{ 0, 5 };
+    std::string out = "{\"seq\":1,\"players\":[";
+    int i = 0;
+    while(out.size() < size) {
+      if(i > 0) {
+        out += ',';
+      }
+      out += "{\"id\":" + std::to_string(i) + ",\"x\":"
+        + std::to_string(coord(rng)) + ",\"y\":" + std::to_string(coord(rng))
+        + ",\"name\":\"";
+      switch(kind) {
+        case text_kind::ascii:
+          out += "player_" + std::to_string(i);
+          break;
+        case text_kind::mixed:
+          if(pick(rng) == 0) {
+            out += latin_names[pick(rng)];
+            out += emoji[pick(rng) % 3];
+          } else {
+            out += "player_" + std::to_string(i);
+          }
+          break;
+        case text_kind::cjk:
+          for(int j = 0; j < 6; j++) {
+            out += cjk[pick(rng)];
+          }
+          break;
+      }
+      out += "\"}";
+      ++i;
+    }
+    out += "]}";
+    return out;
+  }
+
+  bool validate_dfa(const std::string& s) {
+    validator v;
+    return v.decode(s.begin(), s.end()) && v.complete();
+  }
+
+  bool validate_fast(const std::string& s) {
+    validator v;
+    return v.decode(s.data(), s.data() + s.size()) && v.complete();
+  }
+
+  // feeds s to a validator in random chunks with both paths
+  bool check_chunked(const std::string& s, std::mt19937& rng) {
+    validator dfa;
+    validator fast;
+    bool dfa_ok = true;
+    bool fast_ok = true;
+    std::size_t i = 0;
+    while(i < s.size()) {
+      std::size_t n = std::uniform_int_distribution<std::size_t>{
+        1, s.size() - i
+      }(rng);
+      dfa_ok = dfa_ok && dfa.decode(s.begin() + i, s.begin() + i + n);
+      fast_ok = fast_ok && fast.decode(s.data() + i, s.data() + i + n);
+      i += n;
+    }
+    return (dfa_ok && dfa.complete()) == (fast_ok && fast.complete());
+  }
+
+  bool check_agreement() {
+    std::mt19937 rng{ 7 };
+    std::uniform_int_distribution<int> byte{ 0, 255 };
+    std::uniform_int_distribution<int> length{ 0, 300 };
+    std::uniform_int_distribution<int> percent{ 0, 99 };
+    std::size_t invalid_count = 0;
+    for(int i = 0; i < 200000; i++) {
+      std::string s = make_payload(length(rng), text_kind::mixed, rng);
+      s.resize(length(rng) % (s.size() + 1));
+      // corrupt some inputs with random bytes
+      int corruption = percent(rng);
+      for(char& c : s) {
+        if(percent(rng) < corruption / 10) {
+          c = static_cast<char>(byte(rng));
+        }
+      }
+
+      bool expected = validate_dfa(s);
+      invalid_count += !expected;
+      if(validate_fast(s) != expected || !check_chunked(s, rng)) {
+        std::printf("fast path disagrees with the state machine\n");
+        return false;
+      }
+    }
+    std::printf("checked 200000 inputs, %zu of them invalid\n\n",
+      invalid_count);
+    return true;
+  }
+
+  template<typename validate_function>
+  double time_mb_per_s(const std::vector<std::string>& payloads,
+    std::size_t total_bytes, validate_function validate)
+  {
+    std::size_t bytes = 0;
+    std::size_t valid = 0;
+    auto start = clock_type::now();
+    while(bytes < total_bytes) {
+      for(const std::string& p : payloads) {
+        valid += validate(p);
+        bytes += p.size();
+      }
+    }
+    std::chrono::duration<double> elapsed = clock_type::now() - start;
+    if(valid == 0) {
+      std::printf("no payload was valid\n");
+    }
+    return bytes / elapsed.count() / (1 << 20);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t megabytes = 256;
+  if(argc > 1) {
+    megabytes = std::strtoul(argv[1], nullptr, 10);
+  }
+
+#if defined(_WEBSOCKETPP_AVX2_)
+  std::printf("fast path using AVX2\n");
+#elif defined(_WEBSOCKETPP_SSE2_)
+  std::printf("fast path using SSE2\n");
+#else
+  std::printf("fast path using 64-bit words\n");
+#endif
+
+  if(!check_agreement()) {
+    return 1;
+  }
+
+  std::printf("%-8s %8s %14s %14s %8s\n", "text", "bytes", "dfa MB/s",
+    "fast MB/s", "speedup");
+
+  std::mt19937 rng{ 42 };
+  const std::pair<const char*, text_kind> kinds[] = {
+    { "ascii", text_kind::ascii },
+    { "mixed", text_kind::mixed },
+    { "cjk", text_kind::cjk }
+  };
+  for(auto& kind : kinds) {
+    for(std::size_t size : { 64, 512, 4096, 65536 }) {
+      std::vector<std::string> payloads;
+      for(int i = 0; i < 64; i++) {
+        payloads.push_back(make_payload(size, kind.second, rng));
+      }
+      std::size_t total = megabytes << 20;
+      double dfa = time_mb_per_s(payloads, total, validate_dfa);
+      double fast = time_mb_per_s(payloads, total, validate_fast);
+      std::printf("%-8s %8zu %14.0f %14.0f %7.1fx\n", kind.first, size, dfa,
+        fast, fast / dfa);
+    }
+  }
+
+  return 0;
+}
@@ -6,10 +6,12 @@
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+#include <atomic>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 #include <queue>
+#include <list>
 #include <functional>
 
 using std::vector;
@@ -291,6 +293,47 @@ public:
     return m_valid;
   }
 
+  json get_snapshot() const {
+    json snapshot;
+    snapshot["players"] = m_player_list;
+    snapshot["started"] = m_started;
+    snapshot["game_over"] = m_game_over;
+    snapshot["state"] = m_state;
+    snapshot["times"] = std::vector<long>{ m_xtime, m_otime };
+    snapshot["elapsed_time"] = m_elapsed_time;
+    snapshot["moves"] = m_move_list;
+
+    return snapshot;
+  }
+
+  void restore(const json& snapshot) {
+    m_player_list = snapshot.at("players").get<vector<player_id> >();
+    for(player_id player : m_player_list) {
+      m_data_map[player].is_connected = false;
+    }
+
+    m_started = snapshot.at("started").get<bool>();
+    m_game_over = snapshot.at("game_over").get<bool>();
+    m_state = snapshot.at("state").get<int>();
+    m_xtime = snapshot.at("times").at(0).get<long>();
+    m_otime = snapshot.at("times").at(1).get<long>();
+    m_elapsed_time = snapshot.at("elapsed_time").get<long>();
+
+    // replay the moves to rebuild the board
+    m_xmove = true;
+    for(const json& move : snapshot.at("moves")) {
+      unsigned int i = move[0].get<unsigned int>();
+      unsigned int j = move[1].get<unsigned int>();
+      if(m_xmove) {
+        m_board.add_x(i, j);
+      } else {
+        m_board.add_o(i, j);
+      }
+      m_xmove = !m_xmove;
+      m_move_list.push_back(move);
+    }
+  }
+
 private:
   void player_update(
       vector<message>& msg_list,
@@ -422,32 +465,41 @@ public:
     }
   };
 
-  tic_tac_toe_matchmaker() : m_sid_count(0) {}
+  bool can_match() const {
+    return m_queue.size() > 1;
+  }
 
-  bool can_match(
-      const unordered_map<session_id, session_data, id_hash>& session_map
-    )
-  {
-    return session_map.size() > 1;
+  void on_join(const session_id& sid, const session_data& data) {
+    m_queue_positions.emplace(sid, m_queue.insert(m_queue.end(), sid));
+  }
+
+  void on_leave(const session_id& sid) {
+    auto it = m_queue_positions.find(sid);
+    if(it != m_queue_positions.end()) {
+      m_queue.erase(it->second);
+      m_queue_positions.erase(it);
+    }
   }
 
   void match(
       vector<game>& game_list,
       vector<message>& messages,
-      const unordered_map<session_id, session_data, id_hash>& session_map,
       long delta_time
     )
   {
-    vector<session_id> sl;
-    for(auto& spair : session_map) {
-      sl.push_back(spair.first);
-      if(sl.size() > 1) {
-        game_list.emplace_back(
-            std::move(sl), 
-            m_sid_count++,
-            json{ { "matched", true } }
-          );
+    // pair sessions in the order they joined the queue
+    while(m_queue.size() > 1) {
+      vector<session_id> sl;
+      for(std::size_t i = 0; i < 2; ++i) {
+        sl.push_back(m_queue.front());
+        m_queue_positions.erase(m_queue.front());
+        m_queue.pop_front();
       }
+      game_list.emplace_back(
+          std::move(sl),
+          next_game_id(),
+          json{ { "matched", true } }
+        );
     }
   }
 
@@ -458,7 +510,18 @@ public:
   }
 
 private:
-  session_id m_sid_count;
+  // shared by all instances, so ids stay unique across a server's queues
+  static session_id next_game_id() {
+    static std::atomic<unsigned long> sid_count{ 0 };
+    return static_cast<session_id>(sid_count++);
+  }
+
+  std::list<session_id> m_queue;
+  unordered_map<
+      session_id,
+      std::list<session_id>::iterator,
+      id_hash
+    > m_queue_positions;
 };
 
 #endif // TIC_TAC_TOE_HPP
@@ -31,6 +31,14 @@
 
 #include <spdlog/spdlog.h>
 
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <memory>
+#include <string>
+#include <tuple>
 #include <vector>
 #include <queue>
 #include <set>
@@ -135,6 +143,20 @@ namespace simple_web_game_server {
     using ssl_context_ptr = 
       websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context>;
 
+    /// Counts of the frames written to connections and the writes sending them.
+    struct write_stats {
+      /// The number of WebSocket frames written.
+      std::size_t frames = 0;
+      /// The number of socket write operations, each a single system call
+      /// unless the socket would block.
+      std::size_t writes = 0;
+
+      /// Returns the mean number of frames sent per socket write.
+      double frames_per_write() const {
+        return writes > 0 ? static_cast<double>(frames) / writes : 0;
+      }
+    };
+
   private:
     using time_point = std::chrono::time_point<clock>;
 
@@ -150,6 +172,7 @@ namespace simple_web_game_server {
     /// The type of the websocket server.
     using ws_server = websocketpp::server<server_config>;
     using message_ptr = typename ws_server::message_ptr;
+    using steady_timer = websocketpp::lib::asio::steady_timer;
 
     /// The type of an action that may be submitted to queue for the worker
     /// threads running the process_messages() loop.
@@ -167,11 +190,19 @@ namespace simple_web_game_server {
 
     /// The type of the result data of given session.
     struct session_data {
-      session_data(const session_id& s, json&& d) : session(s), data(d) {}
+      session_data(const session_id& s, const json& d) : session(s), data(d) {}
       session_id session;
       json data;
     };
 
+    /// A result string to be sent to a client before closing its connection.
+    struct result_token {
+      connection_hdl hdl;
+      combined_id id;
+      const json* data;
+      std::string msg;
+    };
+
     /**
      * A class wrapping a pair of maps and imitating the functionality of map
      * with the change that the clear() member function must be
@@ -238,16 +269,21 @@ namespace simple_web_game_server {
         const jwt::verifier<jwt_clock, json_traits>& v,
         function<std::string(const combined_id&, const json&)> f,
         std::chrono::milliseconds t
-      ) : m_is_running(false), m_jwt_verifier(v), m_get_result_str(f),
-          m_session_release_time(t),
+      ) : m_is_running(false), m_is_draining(false), m_jwt_verifier(v),
+          m_get_result_str(f), m_session_release_time(t),
           m_handle_open([](const combined_id&, json&&){}),
           m_handle_close([](const combined_id&){}),
-          m_handle_message([](const combined_id&, std::string&&){})
+          m_handle_message([](const combined_id&, std::string&&){}),
+          m_handle_drain_open([](const session_id&){ return false; }),
+          m_ping_interval(0)
     {
       m_server.init_asio();
+      m_ping_timer = std::make_unique<steady_timer>(m_server.get_io_service());
 
       m_server.set_open_handler(bind(&base_server::on_open, this,
         simple_web_game_server::_1));
+      m_server.set_pong_handler(bind(&base_server::on_pong, this,
+        simple_web_game_server::_1, simple_web_game_server::_2));
       m_server.set_close_handler(bind(&base_server::on_close, this,
         simple_web_game_server::_1));
       m_server.set_message_handler(
@@ -292,6 +328,103 @@ namespace simple_web_game_server {
       }
     }
 
+    /// Sets the function deciding if a session may be opened while draining.
+    /**
+     * While draining, a client providing a valid JWT for a session with no
+     * other connected players is only accepted if the given function returns
+     * true for its session id. By default all such sessions are rejected.
+     */
+    void set_drain_handler(function<bool(const session_id&)> f) {
+      if(!m_is_running) {
+        m_handle_drain_open = f;
+      } else {
+        throw server_error{"set_drain_handler called on running server"};
+      }
+    }
+
+    /// Sets how often each verified connection is sent a WebSocket ping.
+    /**
+     * The round trip time to each pong is recorded for the server as a whole
+     * and for each connected player, without any application messages. An
+     * interval of zero, the default, sends no pings.
+     */
+    void set_ping_interval(std::chrono::milliseconds interval) {
+      if(!m_is_running) {
+        m_ping_interval = interval;
+      } else {
+        throw server_error{"set_ping_interval called on running server"};
+      }
+    }
+
+    /// Returns the histogram of ping round trip times of all connections.
+    const latency_histogram& get_rtt_histogram() const {
+      return m_rtt_times;
+    }
+
+    /// Adds the round trip times of the given player to the given histogram.
+    /**
+     * Returns false if the player is not connected.
+     */
+    bool get_player_rtt(const combined_id& id, latency_histogram& rtt_times) {
+      lock_guard<mutex> guard(m_connection_lock);
+      auto it = m_player_rtt_times.find(id);
+      if(it == m_player_rtt_times.end()) {
+        return false;
+      }
+      rtt_times.merge(*it->second);
+      return true;
+    }
+
+    /// Adds the round trip times of the given session to the given histogram.
+    /**
+     * Merges the round trip times of every connected player of the session.
+     * Returns false if no player of the session is connected.
+     */
+    bool get_session_rtt(const session_id& sid, latency_histogram& rtt_times) {
+      vector<player_id> players;
+      {
+        lock_guard<mutex> guard(m_session_lock);
+        auto it = m_session_players.find(sid);
+        if(it == m_session_players.end()) {
+          return false;
+        }
+        players.assign(it->second.begin(), it->second.end());
+      }
+
+      bool result = false;
+      lock_guard<mutex> guard(m_connection_lock);
+      for(const player_id& pid : players) {
+        auto it = m_player_rtt_times.find(combined_id{ pid, sid });
+        if(it != m_player_rtt_times.end()) {
+          rtt_times.merge(*it->second);
+          result = true;
+        }
+      }
+      return result;
+    }
+
+    /// Returns the frames written to connections and the writes sending them.
+    /**
+     * Frames queued for a connection are gathered into a single write, up to
+     * the server_config::max_frames_per_write, so the frames per write show
+     * how well sends made in the same tick are batched. Covers every
+     * connection that has opened, each counted live until its close handler
+     * adds its final counts to those of closed connections.
+     */
+    write_stats get_write_stats() {
+      lock_guard<mutex> guard(m_write_stats_lock);
+      write_stats stats = m_closed_write_stats;
+      for(const connection_hdl& hdl : m_open_connections) {
+        websocketpp::lib::error_code ec;
+        auto con = m_server.get_con_from_hdl(hdl, ec);
+        if(!ec) {
+          stats.frames += con->get_frames_written();
+          stats.writes += con->get_write_op_count();
+        }
+      }
+      return stats;
+    }
+
     /// Runs the underlying websocketpp server m_server.
     /**
      * May be called by multiple threads if desired, so long as unlock_address
@@ -305,6 +438,10 @@ namespace simple_web_game_server {
         m_server.set_reuse_addr(unlock_address);
         m_server.listen(port);
         m_server.start_accept();
+
+        if(m_ping_interval.count() > 0) {
+          start_ping_timer();
+        }
       }
 
       m_server.run();
@@ -315,6 +452,27 @@ namespace simple_web_game_server {
       return m_is_running;
     }
 
+    /// Stops the server from opening new sessions.
+    /**
+     * Existing connections are unaffected, and clients may still join
+     * sessions that have connected players or that are accepted by the
+     * function set with set_drain_handler(). All other clients are closed
+     * with close_reasons::server_shutdown() after verification.
+     */
+    void drain() {
+      if(m_is_running) {
+        spdlog::info("server is draining");
+        m_is_draining = true;
+      } else {
+        throw server_error("drain called on stopped server");
+      }
+    }
+
+    /// Returns whether the server is draining.
+    bool is_draining() {
+      return m_is_draining;
+    }
+
     /// Resets the server so it may be started again.
     void reset() {
       if(m_is_running) {
@@ -327,7 +485,12 @@ namespace simple_web_game_server {
     void stop() {
       if(m_is_running) {
         m_is_running = false;
+        m_is_draining = false;
         m_server.stop_listening();
+        websocketpp::lib::asio::post(
+            m_server.get_io_service(),
+            [this]() { m_ping_timer->cancel(); }
+          );
         {
           lock_guard<mutex> action_guard(m_action_lock);
           lock_guard<mutex> session_guard(m_session_lock);
@@ -354,6 +517,7 @@ namespace simple_web_game_server {
 
           m_connection_ids.clear();
           m_id_connections.clear();
+          m_player_rtt_times.clear();
           m_new_connections.clear();
           m_locked_sessions.clear();
           m_locked_sessions.clear();
@@ -487,6 +651,44 @@ namespace simple_web_game_server {
       }
     }
 
+    /// Asynchronously sends a batch of messages.
+    /**
+     * Equivalent to calling send_message for each (id, msg) pair, but looks
+     * up all connections and submits all actions under a single acquisition
+     * of each lock, waking the process_messages() threads once.
+     */
+    void send_messages(vector<pair<combined_id, std::string> >&& messages) {
+      vector<action> actions;
+      actions.reserve(messages.size());
+      {
+        lock_guard<mutex> guard(m_connection_lock);
+        for(auto& msg_pair : messages) {
+          auto it = m_id_connections.find(msg_pair.first);
+          if(it != m_id_connections.end()) {
+            actions.emplace_back(
+                OUT_MESSAGE, it->second, std::move(msg_pair.second)
+              );
+          } else {
+            spdlog::trace(
+                "ignored message sent to player {} with session {}: connection closed",
+                msg_pair.first.player, msg_pair.first.session
+              );
+          }
+        }
+      }
+
+      if(actions.empty()) {
+        return;
+      }
+      {
+        lock_guard<mutex> guard(m_action_lock);
+        for(action& a : actions) {
+          m_actions.push(std::move(a));
+        }
+      }
+      m_action_cond.notify_all();
+    }
+
     /// Asynchronously closes the given session and sends out result tokens.
     /**
      * Submits actions to close all clients associated with the given session
@@ -503,48 +705,53 @@ namespace simple_web_game_server {
         const json& result_data
       )
     {
-      unique_lock<mutex> lock(m_session_lock);
-      update_session_locks();
-      if(!m_locked_sessions.contains(sid)) {
-        spdlog::trace("completing session {}", sid);
-        session_data result{result_sid, result_data};
+      vector<result_token> tokens;
+      {
+        lock_guard<mutex> lock(m_session_lock);
+        update_session_locks();
+        lock_session(sid, result_sid, result_data, tokens);
+      }
 
-        auto it = m_session_players.find(sid);
-        if(it != m_session_players.end()) {
-          if(it->second.size() > 0) {
-            for(const player_id& pid : it->second) {
-              combined_id id{ pid, sid };
-
-              connection_hdl hdl;
-              if(get_connection_hdl_from_id(hdl, id)) {
-                {
-                  lock_guard<mutex> guard(m_action_lock);
-                  spdlog::trace("closing session {} player {}", sid, pid);
-                  m_actions.push(action(
-                        CLOSE_CONNECTION,
-                        hdl,
-                        m_get_result_str(
-                          { id.player, result.session },
-                          result.data
-                        )
-                      ));
-                }
-                m_action_cond.notify_one();
-              } else {
-                spdlog::trace(
-                    "can't close player {} session {}: connection already closed",
-                    id.player,
-                    id.session
-                  );
-              }
-            }
+      for(result_token& token : tokens) {
+        token.msg = m_get_result_str(token.id, *token.data);
+      }
+      push_result_tokens(tokens);
+    }
+
+    /// Asynchronously closes a batch of sessions and sends out result tokens.
+    /**
+     * Equivalent to calling complete_session(sid, result_sid, result_data)
+     * for each sid of each given tuple (sids, result_sid, result_data), e.g.
+     * each game formed by a matchmaker. Acquires the session lock once,
+     * constructs the result strings in parallel outside of it, and submits
+     * all the resulting actions at once, so m_get_result_str must be safe to
+     * call concurrently.
+     */
+    void complete_sessions(
+        const vector<std::tuple<vector<session_id>, session_id, json> >& results
+      )
+    {
+      vector<result_token> tokens;
+      {
+        lock_guard<mutex> lock(m_session_lock);
+        update_session_locks();
+        for(auto& result : results) {
+          for(const session_id& sid : std::get<0>(result)) {
+            lock_session(sid, std::get<1>(result), std::get<2>(result), tokens);
           }
         }
-
-        m_locked_sessions.insert(
-            std::make_pair(sid, std::move(result))
-          );
       }
+
+      // signing is by far the most expensive step, and tokens are independent
+      std::for_each(
+          std::execution::par,
+          tokens.begin(),
+          tokens.end(),
+          [this](result_token& token) {
+            token.msg = m_get_result_str(token.id, *token.data);
+          }
+        );
+      push_result_tokens(tokens);
     }
 
   private:
@@ -553,6 +760,7 @@ namespace simple_web_game_server {
         lock_guard<mutex> connection_guard(m_connection_lock);
         m_connection_ids.erase(hdl);
         m_id_connections.erase(id);
+        m_player_rtt_times.erase(id);
       }
       {
         lock_guard<mutex> session_guard(m_session_lock);
@@ -611,6 +819,10 @@ namespace simple_web_game_server {
     }
 
     void on_open(connection_hdl hdl) {
+      {
+        lock_guard<mutex> guard(m_write_stats_lock);
+        m_open_connections.insert(hdl);
+      }
       {
         lock_guard<mutex> guard(m_action_lock);
         if(m_is_running) {
@@ -623,6 +835,19 @@ namespace simple_web_game_server {
     }
 
     void on_close(connection_hdl hdl) {
+      {
+        // moves the counts of the connection to those of closed connections
+        // in one step, so get_write_stats() counts them exactly once
+        lock_guard<mutex> guard(m_write_stats_lock);
+        websocketpp::lib::error_code ec;
+        auto con = m_server.get_con_from_hdl(hdl, ec);
+        if(!ec) {
+          m_closed_write_stats.frames += con->get_frames_written();
+          m_closed_write_stats.writes += con->get_write_op_count();
+        }
+        m_open_connections.erase(hdl);
+      }
+
       {
         lock_guard<mutex> guard(m_action_lock);
         m_actions.push(action(UNSUBSCRIBE, hdl));
@@ -630,6 +855,66 @@ namespace simple_web_game_server {
       m_action_cond.notify_one();
     }
 
+    void on_pong(connection_hdl hdl, std::string payload) {
+      // the payload is the steady_clock time the ping was sent, pongs with
+      // any other payload were not requested by the server
+      long long sent;
+      try {
+        sent = std::stoll(payload);
+      } catch(std::exception& e) {
+        spdlog::trace("ignored unsolicited pong: {}", payload);
+        return;
+      }
+      const auto rtt = std::chrono::steady_clock::now().time_since_epoch()
+        - std::chrono::nanoseconds{ sent };
+      m_rtt_times.record(rtt);
+
+      lock_guard<mutex> guard(m_connection_lock);
+      auto it = m_connection_ids.find(hdl);
+      if(it != m_connection_ids.end()) {
+        auto rtt_it = m_player_rtt_times.find(it->second);
+        if(rtt_it != m_player_rtt_times.end()) {
+          rtt_it->second->record(rtt);
+        }
+      }
+    }
+
+    void start_ping_timer() {
+      m_ping_timer->expires_after(m_ping_interval);
+      m_ping_timer->async_wait(
+          [this](const websocketpp::lib::asio::error_code& ec) {
+            if(!ec && m_is_running) {
+              ping_connections();
+              start_ping_timer();
+            }
+          }
+        );
+    }
+
+    void ping_connections() {
+      vector<connection_hdl> hdls;
+      {
+        lock_guard<mutex> guard(m_connection_lock);
+        hdls.reserve(m_connection_ids.size());
+        for(auto& con_pair : m_connection_ids) {
+          hdls.push_back(con_pair.first);
+        }
+      }
+
+      const std::string payload = std::to_string(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+          ).count()
+        );
+      for(connection_hdl& hdl : hdls) {
+        websocketpp::lib::error_code ec;
+        m_server.ping(hdl, payload, ec);
+        if(ec) {
+          spdlog::trace("error sending ping: {}", ec.message());
+        }
+      }
+    }
+
     void on_message(connection_hdl hdl, message_ptr msg) {
       {
         lock_guard<mutex> guard(m_action_lock);
@@ -638,6 +923,61 @@ namespace simple_web_game_server {
       m_action_cond.notify_one();
     }
 
+    // marks a session completed and collects the connections to be sent a
+    // result token, assumes that m_session_lock is acquired
+    void lock_session(
+        const session_id& sid,
+        const session_id& result_sid,
+        const json& result_data,
+        vector<result_token>& tokens
+      )
+    {
+      if(m_locked_sessions.contains(sid)) {
+        return;
+      }
+
+      spdlog::trace("completing session {}", sid);
+      auto it = m_session_players.find(sid);
+      if(it != m_session_players.end()) {
+        for(const player_id& pid : it->second) {
+          combined_id id{ pid, sid };
+
+          connection_hdl hdl;
+          if(get_connection_hdl_from_id(hdl, id)) {
+            spdlog::trace("closing session {} player {}", sid, pid);
+            tokens.push_back(
+                result_token{ hdl, { pid, result_sid }, &result_data, "" }
+              );
+          } else {
+            spdlog::trace(
+                "can't close player {} session {}: connection already closed",
+                id.player,
+                id.session
+              );
+          }
+        }
+      }
+
+      m_locked_sessions.insert(
+          std::make_pair(sid, session_data{ result_sid, result_data })
+        );
+    }
+
+    void push_result_tokens(vector<result_token>& tokens) {
+      if(tokens.empty()) {
+        return;
+      }
+      {
+        lock_guard<mutex> guard(m_action_lock);
+        for(result_token& token : tokens) {
+          m_actions.push(
+              action(CLOSE_CONNECTION, token.hdl, std::move(token.msg))
+            );
+        }
+      }
+      m_action_cond.notify_all();
+    }
+
     // assumes that m_session_lock is acquired
     void update_session_locks() {
       auto delta_time = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -675,6 +1015,10 @@ namespace simple_web_game_server {
       m_connection_ids.emplace(hdl, id);
       m_id_connections.emplace(id, hdl);
       m_new_connections.erase(hdl);
+      if(m_ping_interval.count() > 0) {
+        // a duplicate connection keeps the round trip times of the player
+        m_player_rtt_times.emplace(id, std::make_unique<latency_histogram>());
+      }
     }
 
     void open_session(connection_hdl hdl, const std::string& login_token) {
@@ -718,7 +1062,25 @@ namespace simple_web_game_server {
         lock_guard<mutex> session_guard(m_session_lock);
         update_session_locks();
 
-        if(!m_locked_sessions.contains(id.session)) {
+        if(m_locked_sessions.contains(id.session)) {
+          send_to_hdl(
+              hdl,
+              m_get_result_str(
+                  { id.player, m_locked_sessions.at(id.session).session },
+                  m_locked_sessions.at(id.session).data
+                )
+            );
+          close_hdl(hdl, close_reasons::session_complete());
+        } else if(m_is_draining && m_session_players.count(id.session) == 0
+            && !m_handle_drain_open(id.session))
+        {
+          spdlog::debug(
+              "rejected player {} session {}: server is draining",
+              id.player,
+              id.session
+            );
+          close_hdl(hdl, close_reasons::server_shutdown());
+        } else {
           setup_connection_id(hdl, id);
           m_session_players[id.session].insert(id.player);
           spdlog::debug(
@@ -728,15 +1090,6 @@ namespace simple_web_game_server {
               login_json.dump()
             );
           m_handle_open(id, std::move(login_json));
-        } else {
-          send_to_hdl(
-              hdl,
-              m_get_result_str(
-                  { id.player, m_locked_sessions.at(id.session).session },
-                  m_locked_sessions.at(id.session).data
-                )
-            );
-          close_hdl(hdl, close_reasons::session_complete());
         }
       } else {
         close_hdl(hdl, close_reasons::invalid_jwt());
@@ -746,6 +1099,7 @@ namespace simple_web_game_server {
     // member variables
     ws_server m_server;
     atomic<bool> m_is_running;
+    atomic<bool> m_is_draining;
 
     jwt::verifier<jwt_clock, json_traits> m_jwt_verifier;
     function<std::string(const combined_id&, const json&)> m_get_result_str;
@@ -757,9 +1111,14 @@ namespace simple_web_game_server {
         std::owner_less<connection_hdl>
       > m_connection_ids;
     unordered_map<combined_id, connection_hdl, id_hash> m_id_connections;
+    unordered_map<
+        combined_id,
+        std::unique_ptr<latency_histogram>,
+        id_hash
+      > m_player_rtt_times;
 
     // m_connection_lock guards the members m_new_connections,
-    // m_id_connections, and m_connection_ids
+    // m_id_connections, m_connection_ids, and m_player_rtt_times
     mutex m_connection_lock;
 
     time_point m_last_session_update_time;
@@ -784,6 +1143,18 @@ namespace simple_web_game_server {
     function<void(const combined_id&, json&&)> m_handle_open;
     function<void(const combined_id&)> m_handle_close;
     function<void(const combined_id&, std::string&&)> m_handle_message;
+    function<bool(const session_id&)> m_handle_drain_open;
+
+    std::chrono::milliseconds m_ping_interval;
+    std::unique_ptr<steady_timer> m_ping_timer;
+    latency_histogram m_rtt_times;
+
+    set<connection_hdl, std::owner_less<connection_hdl> > m_open_connections;
+    write_stats m_closed_write_stats;
+
+    // m_write_stats_lock guards the members m_open_connections and
+    // m_closed_write_stats
+    mutex m_write_stats_lock;
   };
 }
 
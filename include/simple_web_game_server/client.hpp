@@ -23,14 +23,24 @@
 #ifndef JWT_GAME_SERVER_BASE_CLIENT_HPP
 #define JWT_GAME_SERVER_BASE_CLIENT_HPP
 
+#include <websocketpp/common/asio.hpp>
 #include <websocketpp/client.hpp>
 
 #include <jwt-cpp/jwt.h> 
 #include <spdlog/spdlog.h>
 
+#include "latency_histogram.hpp"
+
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
 #include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <exception>
 
@@ -50,12 +60,32 @@ namespace simple_web_game_server {
   using std::lock_guard;
 
   /// A simple WebSocket client to connect to an instance of base_server.
+  /**
+   * Messages are sent asynchronously. Sends made within the send window of
+   * one another are held and handed to the connection together, so that
+   * they are written to the socket in as few writes as possible, and sends
+   * made before the connection opens are sent after the JWT once it does.
+   * The number of bytes waiting to be written is reported by
+   * get_buffered_amount(), and sends are rejected while it exceeds the
+   * limit set with set_max_buffered_amount().
+   *
+   * If reconnection is enabled with set_reconnect(), a connection that drops
+   * without a normal close is reopened with the same URI and JWT after a
+   * randomly jittered, exponentially growing delay, so that clients dropped
+   * together by an outage do not all reconnect at once. Messages sent while
+   * reconnecting are sent once the connection reopens.
+   *
+   * If a ping interval is set, the client pings the server periodically and
+   * records the round trip time of each pong in get_rtt_histogram().
+   */
   template<typename client_config>
   class client {
   // type definitions
   private:
     using ws_client = websocketpp::client<client_config>;
     using message_ptr = typename ws_client::message_ptr;
+    using message_type = typename client_config::message_type;
+    using steady_timer = websocketpp::lib::asio::steady_timer;
 
   public:
     /// The class representing errors with the client.
@@ -72,7 +102,12 @@ namespace simple_web_game_server {
     /// Constructs the client with empty handler functions.
     client() : m_is_running{false}, m_has_failed{false},
       m_handle_open{[](){}}, m_handle_close{[](){}},
-      m_handle_message{[](const std::string& s){}}
+      m_handle_message{[](const std::string& s){}},
+      m_is_open{false}, m_is_flush_pending{false}, m_send_window{0},
+      m_max_buffered_amount{0}, m_queued_amount{0},
+      m_is_disconnecting{false}, m_is_reconnecting{false},
+      m_max_reconnect_attempts{0}, m_reconnect_attempt{0},
+      m_rng{std::random_device{}()}, m_ping_interval{0}
     {
       m_client.init_asio();
 
@@ -80,6 +115,10 @@ namespace simple_web_game_server {
         simple_web_game_server::_1));
       m_client.set_close_handler(bind(&client::on_close, this,
         simple_web_game_server::_1));
+      m_client.set_fail_handler(bind(&client::on_fail, this,
+        simple_web_game_server::_1));
+      m_client.set_pong_handler(bind(&client::on_pong, this,
+        simple_web_game_server::_1, simple_web_game_server::_2));
       m_client.set_message_handler(
           bind(&client::on_message, this, simple_web_game_server::_1,
             simple_web_game_server::_2)
@@ -93,7 +132,12 @@ namespace simple_web_game_server {
         std::function<void(const std::string&)> mf
       ) : m_is_running{false}, m_has_failed{false},
           m_handle_open{of}, m_handle_close{cf},
-          m_handle_message{mf}
+          m_handle_message{mf},
+          m_is_open{false}, m_is_flush_pending{false}, m_send_window{0},
+          m_max_buffered_amount{0}, m_queued_amount{0},
+          m_is_disconnecting{false}, m_is_reconnecting{false},
+          m_max_reconnect_attempts{0}, m_reconnect_attempt{0},
+          m_rng{std::random_device{}()}, m_ping_interval{0}
     {
       m_client.init_asio();
 
@@ -101,6 +145,10 @@ namespace simple_web_game_server {
         simple_web_game_server::_1));
       m_client.set_close_handler(bind(&client::on_close, this,
         simple_web_game_server::_1));
+      m_client.set_fail_handler(bind(&client::on_fail, this,
+        simple_web_game_server::_1));
+      m_client.set_pong_handler(bind(&client::on_pong, this,
+        simple_web_game_server::_1, simple_web_game_server::_2));
       m_client.set_message_handler(
           bind(&client::on_message, this, simple_web_game_server::_1,
             simple_web_game_server::_2)
@@ -114,15 +162,38 @@ namespace simple_web_game_server {
         return;
       }
 
+      m_uri = uri;
       m_jwt = jwt;
+      m_is_disconnecting = false;
+      m_is_reconnecting = false;
+      m_reconnect_attempt = 0;
+      {
+        lock_guard<mutex> guard(m_send_lock);
+        m_send_queue.clear();
+        m_queued_amount = 0;
+        m_is_flush_pending = false;
+      }
 
       websocketpp::lib::error_code ec;
-      m_connection = m_client.get_connection(uri, ec);
+      auto con = m_client.get_connection(uri, ec);
       if(ec) {
         spdlog::debug(ec.message());
       } else {
         try {
-          m_client.connect(m_connection);
+          m_flush_timer = std::make_unique<steady_timer>(
+              m_client.get_io_service()
+            );
+          m_reconnect_timer = std::make_unique<steady_timer>(
+              m_client.get_io_service()
+            );
+          m_ping_timer = std::make_unique<steady_timer>(
+              m_client.get_io_service()
+            );
+          {
+            lock_guard<mutex> guard(m_send_lock);
+            m_connection = con;
+          }
+          m_client.connect(con);
           m_is_running = true;
           m_has_failed = false;
           m_client.run();
@@ -144,12 +215,37 @@ namespace simple_web_game_server {
       return m_has_failed;
     }
 
+    /// Returns whether a dropped connection is being reopened.
+    bool is_reconnecting() {
+      return m_is_reconnecting;
+    }
+
     /// Close the connection to the server.
+    /**
+     * Messages held in the send window are sent before the close. Stops any
+     * reconnection in progress.
+     */
     void disconnect() {
       if(m_is_running) {
+        m_is_disconnecting = true;
+        if(m_is_reconnecting) {
+          // a connection still opening is closed in on_open or on_fail
+          websocketpp::lib::asio::post(
+              m_client.get_io_service(),
+              [this]() { m_reconnect_timer->cancel(); }
+            );
+          return;
+        }
+
+        flush_sends();
+        typename ws_client::connection_ptr con;
+        {
+          lock_guard<mutex> guard(m_send_lock);
+          con = m_connection;
+        }
         try {
           spdlog::trace("closing client connection");
-          m_connection->close(
+          con->close(
               websocketpp::close::status::normal,
               "client closed connection"
             );
@@ -169,25 +265,129 @@ namespace simple_web_game_server {
       m_client.reset();
     }
 
-    /// Synchronously send the given string to the server.
-    void send(const std::string& msg) {
-      if(m_is_running) {
-        try {
-          m_connection->send(
-              msg,
-              websocketpp::frame::opcode::text
-            );
-          spdlog::debug("client sent message: {}", msg);
-        } catch(std::exception& e) {
-          spdlog::error("error sending client message \"{}\": {}", msg,
-            e.what());
-        }
-      } else {
+    /// Asynchronously sends the given string to the server.
+    /**
+     * Returns false, dropping the message, if the bytes waiting to be written
+     * would exceed the maximum buffered amount.
+     */
+    bool send(const std::string& msg) {
+      return send(std::string{msg});
+    }
+
+    /// Asynchronously sends the given string to the server without copying.
+    /**
+     * Returns false, dropping the message, if the bytes waiting to be written
+     * would exceed the maximum buffered amount.
+     */
+    bool send(std::string&& msg) {
+      if(!m_is_running) {
         throw client_error{
             std::string{"send called on stopped client with message: "} + 
             msg
           };
       }
+
+      const std::size_t max_amount = m_max_buffered_amount;
+      if(max_amount > 0 && get_buffered_amount() + msg.size() > max_amount) {
+        spdlog::debug(
+            "client dropped message of {} bytes: send buffer full",
+            msg.size()
+          );
+        return false;
+      }
+
+      spdlog::trace("client sent message: {}", msg);
+
+      lock_guard<mutex> guard(m_send_lock);
+      if(m_is_open && m_send_window.count() == 0) {
+        write_message(std::move(msg));
+      } else {
+        m_queued_amount += msg.size();
+        m_send_queue.push_back(std::move(msg));
+        if(m_is_open && !m_is_flush_pending) {
+          m_is_flush_pending = true;
+          websocketpp::lib::asio::post(
+              m_client.get_io_service(),
+              [this]() { start_flush_timer(); }
+            );
+        }
+      }
+      return true;
+    }
+
+    /// Returns the number of bytes sent but not yet written to the socket.
+    std::size_t get_buffered_amount() {
+      lock_guard<mutex> guard(m_send_lock);
+      std::size_t amount = m_queued_amount;
+      if(m_is_open) {
+        amount += m_connection->get_buffered_amount();
+      }
+      return amount;
+    }
+
+    /// Sets how long sends may be held to be written together.
+    /**
+     * A send window of zero, the default, hands each message to the
+     * connection immediately. A longer window trades up to that much added
+     * latency for fewer, larger writes when sending many small messages.
+     */
+    void set_send_window(std::chrono::microseconds window) {
+      if(!m_is_running) {
+        m_send_window = window;
+      } else {
+        throw client_error{"set_send_window called on running client"};
+      }
+    }
+
+    /// Enables reopening connections that drop without a normal close.
+    /**
+     * After the n-th consecutive failed attempt the client waits a random
+     * delay between zero and min(max_delay, initial_delay * 2^n) before the
+     * next one, and gives up, calling the close handler, after max_attempts
+     * attempts. A max_attempts of zero, the default, disables reconnection.
+     * The open handler is called again each time the connection reopens.
+     */
+    void set_reconnect(
+        std::size_t max_attempts,
+        std::chrono::milliseconds initial_delay =
+          std::chrono::milliseconds{250},
+        std::chrono::milliseconds max_delay = std::chrono::milliseconds{30000}
+      )
+    {
+      if(!m_is_running) {
+        m_max_reconnect_attempts = max_attempts;
+        m_initial_reconnect_delay = initial_delay;
+        m_max_reconnect_delay = max_delay;
+      } else {
+        throw client_error{"set_reconnect called on running client"};
+      }
+    }
+
+    /// Sets how often the client pings the server while connected.
+    /**
+     * The round trip time to each pong is recorded in the histogram returned
+     * by get_rtt_histogram(). An interval of zero, the default, sends no
+     * pings.
+     */
+    void set_ping_interval(std::chrono::milliseconds interval) {
+      if(!m_is_running) {
+        m_ping_interval = interval;
+      } else {
+        throw client_error{"set_ping_interval called on running client"};
+      }
+    }
+
+    /// Returns the histogram of ping round trip times.
+    const latency_histogram& get_rtt_histogram() const {
+      return m_rtt_times;
+    }
+
+    /// Sets the most bytes that may wait to be written before sends fail.
+    /**
+     * Zero, the default, never rejects sends.
+     */
+    void set_max_buffered_amount(std::size_t amount) {
+      m_max_buffered_amount = amount;
     }
 
     /// Sets the given function to be called when the client connects.
@@ -220,7 +420,21 @@ namespace simple_web_game_server {
   private:
     void on_open(connection_hdl hdl) {
       spdlog::trace("client connection opened");
-      this->send(m_jwt);
+      m_is_reconnecting = false;
+      m_reconnect_attempt = 0;
+      if(m_is_disconnecting) {
+        close_connection();
+        return;
+      }
+      {
+        lock_guard<mutex> guard(m_send_lock);
+        write_message(std::string{m_jwt});
+        m_is_open = true;
+        write_queued_messages();
+      }
+      if(m_ping_interval.count() > 0) {
+        start_ping_timer();
+      }
       try {
         m_handle_open();
       } catch(std::exception& e) {
@@ -230,6 +444,54 @@ namespace simple_web_game_server {
 
     void on_close(connection_hdl hdl) {
       spdlog::trace("client connection closed");
+      auto con = m_client.get_con_from_hdl(hdl);
+      {
+        lock_guard<mutex> guard(m_send_lock);
+        m_is_open = false;
+        m_is_flush_pending = false;
+      }
+      m_flush_timer->cancel();
+      m_ping_timer->cancel();
+
+      const bool is_dropped = !m_is_disconnecting
+        && con->get_remote_close_code() != websocketpp::close::status::normal;
+      if(is_dropped && m_max_reconnect_attempts > 0) {
+        spdlog::debug(
+            "client connection dropped: {}",
+            websocketpp::close::status::get_string(
+              con->get_remote_close_code()
+            )
+          );
+        start_reconnect_timer();
+      } else {
+        stop();
+      }
+    }
+
+    void on_fail(connection_hdl hdl) {
+      spdlog::debug("client connection failed");
+      if(m_is_reconnecting && !m_is_disconnecting) {
+        start_reconnect_timer();
+      } else {
+        m_has_failed = !m_is_reconnecting;
+        stop();
+      }
+    }
+
+    // called once the client will not reconnect, so connect() returns
+    void stop() {
+      {
+        lock_guard<mutex> guard(m_send_lock);
+        if(!m_send_queue.empty()) {
+          spdlog::debug(
+              "client dropped {} unsent messages on close",
+              m_send_queue.size()
+            );
+        }
+        m_send_queue.clear();
+        m_queued_amount = 0;
+      }
+      m_is_reconnecting = false;
       m_is_running = false;
       try {
         m_handle_close();
@@ -238,6 +500,72 @@ namespace simple_web_game_server {
       }
     }
 
+    void start_reconnect_timer() {
+      if(m_reconnect_attempt >= m_max_reconnect_attempts) {
+        spdlog::debug(
+            "client gave up reconnecting after {} attempts",
+            m_reconnect_attempt
+          );
+        stop();
+        return;
+      }
+
+      // full jitter: a uniformly random delay up to the exponential backoff
+      const long long max_ms = std::min<long long>(
+          m_max_reconnect_delay.count(),
+          m_initial_reconnect_delay.count()
+            << std::min<std::size_t>(m_reconnect_attempt, 30)
+        );
+      std::uniform_int_distribution<long long> delay_dist{0, max_ms};
+      const std::chrono::milliseconds delay{ delay_dist(m_rng) };
+
+      ++m_reconnect_attempt;
+      m_is_reconnecting = true;
+      spdlog::debug(
+          "client reconnecting in {}ms, attempt {}",
+          delay.count(),
+          m_reconnect_attempt
+        );
+
+      m_reconnect_timer->expires_after(delay);
+      m_reconnect_timer->async_wait(
+          [this](const websocketpp::lib::asio::error_code& ec) {
+            if(ec || m_is_disconnecting) {
+              stop();
+            } else {
+              reconnect();
+            }
+          }
+        );
+    }
+
+    void reconnect() {
+      websocketpp::lib::error_code ec;
+      auto con = m_client.get_connection(m_uri, ec);
+      if(ec) {
+        spdlog::debug("error creating client connection: {}", ec.message());
+        start_reconnect_timer();
+        return;
+      }
+      {
+        lock_guard<mutex> guard(m_send_lock);
+        m_connection = con;
+      }
+      m_client.connect(con);
+    }
+
+    void close_connection() {
+      try {
+        spdlog::trace("closing client connection");
+        m_connection->close(
+            websocketpp::close::status::normal,
+            "client closed connection"
+          );
+      } catch(std::exception& e) {
+        spdlog::error("error closing client connection: {}", e.what());
+      }
+    }
+
     void on_message(connection_hdl hdl, message_ptr msg) {
       spdlog::trace("client received message: {}", msg->get_payload());
       try {
@@ -247,15 +575,123 @@ namespace simple_web_game_server {
       }
     }
 
+    void on_pong(connection_hdl hdl, std::string payload) {
+      // the payload is the steady_clock time the ping was sent
+      long long sent;
+      try {
+        sent = std::stoll(payload);
+      } catch(std::exception& e) {
+        spdlog::trace("client ignored unsolicited pong: {}", payload);
+        return;
+      }
+      m_rtt_times.record(
+          std::chrono::steady_clock::now().time_since_epoch()
+            - std::chrono::nanoseconds{ sent }
+        );
+    }
+
+    void start_ping_timer() {
+      m_ping_timer->expires_after(m_ping_interval);
+      m_ping_timer->async_wait(
+          [this](const websocketpp::lib::asio::error_code& ec) {
+            if(ec || !m_is_open) {
+              return;
+            }
+            const std::string payload = std::to_string(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch()
+                ).count()
+              );
+            websocketpp::lib::error_code ping_ec;
+            m_connection->ping(payload, ping_ec);
+            if(ping_ec) {
+              spdlog::debug("error sending client ping: {}", ping_ec.message());
+            }
+            start_ping_timer();
+          }
+        );
+    }
+
+    void start_flush_timer() {
+      m_flush_timer->expires_after(m_send_window);
+      m_flush_timer->async_wait(
+          [this](const websocketpp::lib::asio::error_code& ec) {
+            if(!ec) {
+              flush_sends();
+            }
+          }
+        );
+    }
+
+    void flush_sends() {
+      lock_guard<mutex> guard(m_send_lock);
+      m_is_flush_pending = false;
+      if(m_is_open) {
+        write_queued_messages();
+      }
+    }
+
+    // requires m_send_lock
+    void write_queued_messages() {
+      for(std::string& msg : m_send_queue) {
+        write_message(std::move(msg));
+      }
+      m_send_queue.clear();
+      m_queued_amount = 0;
+    }
+
+    // requires m_send_lock, so that messages are written in the order sent
+    void write_message(std::string&& msg) {
+      // the payload is moved into the message rather than copied as
+      // connection::send(const std::string&) would
+      message_ptr out = websocketpp::lib::make_shared<message_type>(
+          nullptr, websocketpp::frame::opcode::text, 0
+        );
+      out->get_raw_payload() = std::move(msg);
+      out->set_compressed(true);
+
+      websocketpp::lib::error_code ec = m_connection->send(out);
+      if(ec) {
+        spdlog::debug("error sending client message: {}", ec.message());
+      }
+    }
+
     // member variables
     ws_client m_client;
     typename ws_client::connection_ptr m_connection;
     std::atomic<bool> m_is_running;
     std::atomic<bool> m_has_failed;
+    std::string m_uri;
     std::string m_jwt;
     function<void()> m_handle_open;
     function<void()> m_handle_close;
     function<void(const std::string&)> m_handle_message;
+
+    std::unique_ptr<steady_timer> m_flush_timer;
+    std::atomic<bool> m_is_open;
+    std::atomic<bool> m_is_flush_pending;
+    std::chrono::microseconds m_send_window;
+    std::atomic<std::size_t> m_max_buffered_amount;
+
+    std::vector<std::string> m_send_queue;
+    std::atomic<std::size_t> m_queued_amount;
+
+    std::unique_ptr<steady_timer> m_reconnect_timer;
+    std::atomic<bool> m_is_disconnecting;
+    std::atomic<bool> m_is_reconnecting;
+    std::size_t m_max_reconnect_attempts;
+    std::chrono::milliseconds m_initial_reconnect_delay{250};
+    std::chrono::milliseconds m_max_reconnect_delay{30000};
+    std::size_t m_reconnect_attempt;
+    std::mt19937 m_rng;
+
+    std::chrono::milliseconds m_ping_interval;
+    std::unique_ptr<steady_timer> m_ping_timer;
+    latency_histogram m_rtt_times;
+
+    // m_send_lock guards the members m_send_queue, m_is_open, and
+    // m_connection, and orders writes to m_connection
+    mutex m_send_lock;
   };
 }
 
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_CLIENT_POOL_HPP
+#define JWT_GAME_SERVER_CLIENT_POOL_HPP
+
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/client.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <exception>
+
+namespace simple_web_game_server {
+  // websocketpp types
+  using websocketpp::connection_hdl;
+
+  // functional types
+  using std::function;
+
+  // threading type implementations
+  using std::atomic;
+  using std::mutex;
+  using std::lock_guard;
+
+  /// Many WebSocket clients sharing one io_context and a few threads.
+  /**
+   * Where each client owns a websocketpp client and blocks a thread in
+   * connect(), a client_pool holds any number of connections to instances
+   * of base_server on a single websocketpp client endpoint, whose
+   * io_context is run by the threads calling run(). Each connection sends
+   * its JWT once open, exactly like a client, and has its own open, close,
+   * and message handlers. The handlers of one connection are never called
+   * concurrently, but those of different connections may be, so handlers
+   * shared between connections must be thread safe.
+   *
+   * Connections may be added, used, and closed from any thread, before or
+   * while the pool is running. Intended for bots, soak tests, and load
+   * generators simulating thousands of players from one process.
+   */
+  template<typename client_config>
+  class client_pool {
+  // type definitions
+  private:
+    using ws_client = websocketpp::client<client_config>;
+    using message_ptr = typename ws_client::message_ptr;
+    using connection_ptr = typename ws_client::connection_ptr;
+    using strand = websocketpp::lib::asio::io_service::strand;
+
+  public:
+    /// The class representing errors with the client_pool.
+    class client_error : public std::runtime_error {
+    public:
+      using super = std::runtime_error;
+      explicit client_error(const std::string& what_arg) noexcept :
+        super(what_arg) {}
+      explicit client_error(const char* what_arg) noexcept : super(what_arg) {}
+    };
+
+    /// The index of a connection in the pool, in the order they were added.
+    using connection_id = std::size_t;
+
+  private:
+    /// The connection and handlers of a single simulated client.
+    struct connection_state {
+      connection_state(
+          connection_id i,
+          const std::string& t,
+          function<void()> of,
+          function<void()> cf,
+          function<void(const std::string&)> mf
+        ) : id(i), jwt(t), handle_open(of), handle_close(cf), handle_message(mf),
+          is_open(false), has_failed(false) {}
+
+      connection_id id;
+      connection_ptr con;
+      std::string jwt;
+      function<void()> handle_open;
+      function<void()> handle_close;
+      function<void(const std::string&)> handle_message;
+      atomic<bool> is_open;
+      atomic<bool> has_failed;
+    };
+
+  // main class body
+  public:
+    /// Constructs an empty pool.
+    client_pool() : m_is_running(false), m_is_stopping(false),
+      m_open_count(0),
+      m_handle_pong{[](connection_id, const std::string&){}}
+    {
+      m_client.init_asio();
+      m_client.start_perpetual();
+      m_connect_strand = std::make_unique<strand>(m_client.get_io_service());
+    }
+
+    ~client_pool() {
+      stop();
+    }
+
+    /// Adds a connection to the server at the given URI.
+    /**
+     * The connection is opened asynchronously once the pool is running, and
+     * the given JWT is sent as soon as it opens. The close handler is also
+     * called if the connection fails to open. Returns the id of the new
+     * connection.
+     */
+    connection_id connect(
+        const std::string& uri,
+        const std::string& jwt,
+        function<void()> open_handler = [](){},
+        function<void()> close_handler = [](){},
+        function<void(const std::string&)> message_handler =
+          [](const std::string&){}
+      )
+    {
+      connection_state* s;
+      connection_id id;
+      {
+        lock_guard<mutex> guard(m_connection_lock);
+        id = m_connections.size();
+        m_connections.push_back(std::make_unique<connection_state>(
+            id, jwt, open_handler, close_handler, message_handler
+          ));
+        s = m_connections.back().get();
+      }
+
+      // the endpoint's resolver is shared by all connections, so connections
+      // are started one at a time
+      m_connect_strand->post([this, s, uri]() { start_connection(*s, uri); });
+
+      return id;
+    }
+
+    /// Runs the pool on the calling thread and thread_count - 1 others.
+    /**
+     * Returns once stop() is called and all connections have closed.
+     */
+    void run(std::size_t thread_count = 1) {
+      if(m_is_running) {
+        throw client_error("run called on running client_pool");
+      }
+      m_is_running = true;
+
+      std::vector<std::thread> threads;
+      for(std::size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back([this]() { run_client(); });
+      }
+      run_client();
+      for(std::thread& thread : threads) {
+        thread.join();
+      }
+
+      m_is_running = false;
+    }
+
+    /// Closes every connection and lets run() return once they have closed.
+    /**
+     * Connections still opening are closed as soon as they open. A stopped
+     * pool may not be run again.
+     */
+    void stop() {
+      m_is_stopping = true;
+      std::vector<connection_ptr> connections;
+      {
+        lock_guard<mutex> guard(m_connection_lock);
+        for(auto& state : m_connections) {
+          if(state->con && state->is_open) {
+            connections.push_back(state->con);
+          }
+        }
+      }
+
+      for(connection_ptr& con : connections) {
+        close_connection(con);
+      }
+      m_client.stop_perpetual();
+    }
+
+    /// Returns whether the pool is running.
+    bool is_running() {
+      return m_is_running;
+    }
+
+    /// Sends the given string on the given connection.
+    void send(connection_id id, const std::string& msg) {
+      connection_ptr con = get_open_connection(id, "send");
+      try {
+        con->send(msg, websocketpp::frame::opcode::text);
+      } catch(std::exception& e) {
+        spdlog::error("error sending client message \"{}\": {}", msg,
+          e.what());
+      }
+    }
+
+    /// Sends a WebSocket ping with the given payload on the given connection.
+    /**
+     * The server's pong, echoing the payload, is passed to the function set
+     * with set_pong_handler.
+     */
+    void ping(connection_id id, const std::string& payload) {
+      connection_ptr con = get_open_connection(id, "ping");
+      try {
+        con->ping(payload);
+      } catch(std::exception& e) {
+        spdlog::error("error sending client ping: {}", e.what());
+      }
+    }
+
+    /// Sets the function called with each pong received by any connection.
+    void set_pong_handler(
+        function<void(connection_id, const std::string&)> f
+      )
+    {
+      if(!m_is_running) {
+        m_handle_pong = f;
+      } else {
+        throw client_error{"set_pong_handler called on running client_pool"};
+      }
+    }
+
+    /// Closes the given connection.
+    void disconnect(connection_id id) {
+      close_connection(get_open_connection(id, "disconnect"));
+    }
+
+    /// Returns whether the given connection is open.
+    bool is_open(connection_id id) {
+      return get_state(id).is_open;
+    }
+
+    /// Returns whether the given connection failed to open.
+    bool has_failed(connection_id id) {
+      return get_state(id).has_failed;
+    }
+
+    /// Returns the number of open connections.
+    std::size_t get_open_count() {
+      return m_open_count;
+    }
+
+    /// Returns the number of connections added to the pool.
+    std::size_t get_connection_count() {
+      lock_guard<mutex> guard(m_connection_lock);
+      return m_connections.size();
+    }
+
+  private:
+    void run_client() {
+      try {
+        m_client.run();
+      } catch(std::exception& e) {
+        spdlog::error("error running client_pool: {}", e.what());
+      }
+    }
+
+    void start_connection(connection_state& s, const std::string& uri) {
+      websocketpp::lib::error_code ec;
+      connection_ptr con = m_client.get_connection(uri, ec);
+      if(ec) {
+        spdlog::debug("error creating client connection: {}", ec.message());
+        s.has_failed = true;
+        call_handler(s.handle_close, "close");
+        return;
+      }
+
+      con->set_open_handler([this, &s](connection_hdl) { on_open(s); });
+      con->set_close_handler([this, &s](connection_hdl) { on_close(s); });
+      con->set_fail_handler([this, &s](connection_hdl) { on_fail(s); });
+      con->set_pong_handler(
+          [this, &s](connection_hdl, std::string payload) {
+            try {
+              m_handle_pong(s.id, payload);
+            } catch(std::exception& e) {
+              spdlog::error("error in pong handler: {}", e.what());
+            }
+          }
+        );
+      con->set_message_handler(
+          [&s](connection_hdl, message_ptr msg) {
+            spdlog::trace("client received message: {}", msg->get_payload());
+            try {
+              s.handle_message(msg->get_payload());
+            } catch(std::exception& e) {
+              spdlog::error("error in message handler: {}", e.what());
+            }
+          }
+        );
+
+      {
+        lock_guard<mutex> guard(m_connection_lock);
+        s.con = con;
+      }
+      m_client.connect(con);
+    }
+
+    void on_open(connection_state& s) {
+      spdlog::trace("client connection opened");
+      s.is_open = true;
+      ++m_open_count;
+      if(m_is_stopping) {
+        close_connection(s.con);
+        return;
+      }
+      try {
+        s.con->send(s.jwt, websocketpp::frame::opcode::text);
+      } catch(std::exception& e) {
+        spdlog::error("error sending client jwt: {}", e.what());
+      }
+      call_handler(s.handle_open, "open");
+    }
+
+    void on_close(connection_state& s) {
+      spdlog::trace("client connection closed");
+      s.is_open = false;
+      --m_open_count;
+      call_handler(s.handle_close, "close");
+    }
+
+    void on_fail(connection_state& s) {
+      spdlog::debug("client connection failed");
+      s.has_failed = true;
+      call_handler(s.handle_close, "close");
+    }
+
+    static void call_handler(function<void()>& f, const char* name) {
+      try {
+        f();
+      } catch(std::exception& e) {
+        spdlog::error("error in {} handler: {}", name, e.what());
+      }
+    }
+
+    static void close_connection(const connection_ptr& con) {
+      try {
+        spdlog::trace("closing client connection");
+        con->close(
+            websocketpp::close::status::normal,
+            "client closed connection"
+          );
+      } catch(std::exception& e) {
+        spdlog::error("error closing client connection: {}", e.what());
+      }
+    }
+
+    connection_state& get_state(connection_id id) {
+      lock_guard<mutex> guard(m_connection_lock);
+      if(id >= m_connections.size()) {
+        throw client_error{"unknown client_pool connection id"};
+      }
+      return *m_connections[id];
+    }
+
+    connection_ptr get_open_connection(connection_id id, const char* caller) {
+      connection_state& s = get_state(id);
+      lock_guard<mutex> guard(m_connection_lock);
+      if(!s.is_open || !s.con) {
+        throw client_error{
+            std::string{caller} + " called on closed client_pool connection"
+          };
+      }
+      return s.con;
+    }
+
+    // member variables
+    ws_client m_client;
+    std::unique_ptr<strand> m_connect_strand;
+    atomic<bool> m_is_running;
+    atomic<bool> m_is_stopping;
+    atomic<std::size_t> m_open_count;
+    function<void(connection_id, const std::string&)> m_handle_pong;
+
+    std::vector<std::unique_ptr<connection_state> > m_connections;
+
+    // m_connection_lock guards the member m_connections and the con member
+    // of each connection_state
+    mutex m_connection_lock;
+  };
+}
+
+#endif // JWT_GAME_SERVER_CLIENT_POOL_HPP
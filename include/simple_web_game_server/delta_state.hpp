@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_DELTA_STATE_HPP
+#define JWT_GAME_SERVER_DELTA_STATE_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <functional>
+
+namespace simple_web_game_server {
+  /// Sends players JSON Patch deltas of a published game state.
+  /**
+   * Intended to be owned by a game_instance. Each call to publish() or
+   * broadcast() takes the state object a player should currently see and
+   * appends to the game's outgoing messages either a full snapshot
+   *
+   *     { "type": "state", "seq": s, "state": { ... } }
+   *
+   * if the player has no baseline, or an RFC 6902 patch against the last
+   * state the player was sent
+   *
+   *     { "type": "delta", "seq": s, "base": b, "patch": [ ... ] }
+   *
+   * and nothing at all if the state is unchanged. Because WebSocket
+   * messages are delivered reliably and in order, a state handed to a live
+   * connection is treated as acknowledged; the game should call reset()
+   * whenever a player (re)connects so that the next message it is sent is a
+   * full snapshot.
+   *
+   * The json type must provide the nlohmann::json interface, in particular
+   * the static member json::diff.
+   */
+  template<typename player_id, typename json,
+    typename player_hash = std::hash<player_id> >
+  class delta_state {
+  public:
+    /// The type of an outgoing message, matching game_instance::message.
+    using message = std::pair<player_id, std::string>;
+
+    delta_state() : m_seq(0) {}
+
+    /// Publishes a per-player view of the state to a single player.
+    void publish(
+        std::vector<message>& out_messages,
+        const player_id& pid,
+        const json& view
+      )
+    {
+      const unsigned long seq = ++m_seq;
+      std::optional<std::string> full_msg;
+      std::unordered_map<unsigned long, std::string> delta_msgs;
+      publish_to(out_messages, pid, view, seq, full_msg, delta_msgs);
+    }
+
+    /// Publishes a state shared by all of the given players.
+    /**
+     * Players sharing a baseline share a single diff and serialization, so
+     * in the common case where every player is in sync the state is diffed
+     * and dumped once per call rather than once per player.
+     */
+    template<typename player_range>
+    void broadcast(
+        std::vector<message>& out_messages,
+        const player_range& players,
+        const json& state
+      )
+    {
+      const unsigned long seq = ++m_seq;
+      std::optional<std::string> full_msg;
+      std::unordered_map<unsigned long, std::string> delta_msgs;
+      for(const player_id& pid : players) {
+        publish_to(out_messages, pid, state, seq, full_msg, delta_msgs);
+      }
+    }
+
+    /// Forgets the baseline of the given player.
+    /**
+     * The next state sent to the player will be a full snapshot. Call when a
+     * player connects or reconnects.
+     */
+    void reset(const player_id& pid) {
+      m_players.erase(pid);
+    }
+
+    /// Forgets the baselines of all players.
+    void clear() {
+      m_players.clear();
+    }
+
+  private:
+    struct baseline {
+      unsigned long seq;
+      json state;
+    };
+
+    void publish_to(
+        std::vector<message>& out_messages,
+        const player_id& pid,
+        const json& state,
+        unsigned long seq,
+        std::optional<std::string>& full_msg,
+        std::unordered_map<unsigned long, std::string>& delta_msgs
+      )
+    {
+      auto it = m_players.find(pid);
+      if(it == m_players.end()) {
+        if(!full_msg) {
+          json msg_json;
+          msg_json["type"] = "state";
+          msg_json["seq"] = seq;
+          msg_json["state"] = state;
+          full_msg = msg_json.dump();
+        }
+        out_messages.emplace_back(pid, *full_msg);
+        m_players.emplace(pid, baseline{ seq, state });
+        return;
+      }
+
+      baseline& base = it->second;
+      if(base.seq == seq || base.state == state) {
+        return;
+      }
+
+      auto msg_it = delta_msgs.find(base.seq);
+      if(msg_it == delta_msgs.end()) {
+        json msg_json;
+        msg_json["type"] = "delta";
+        msg_json["seq"] = seq;
+        msg_json["base"] = base.seq;
+        msg_json["patch"] = json::diff(base.state, state);
+        msg_it = delta_msgs.emplace(base.seq, msg_json.dump()).first;
+      }
+      out_messages.emplace_back(pid, msg_it->second);
+
+      base.seq = seq;
+      base.state = state;
+    }
+
+    std::unordered_map<player_id, baseline, player_hash> m_players;
+    unsigned long m_seq;
+  };
+}
+
+#endif // JWT_GAME_SERVER_DELTA_STATE_HPP
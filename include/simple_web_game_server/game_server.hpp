@@ -24,15 +24,37 @@
 #define JWT_GAME_SERVER_GAME_SERVER_HPP
 
 #include "base_server.hpp"
+#include "latency_histogram.hpp"
 
 #include <chrono>
 #include <algorithm>
 #include <execution>
+#include <optional>
+#include <iterator>
+#include <unordered_set>
+#include <istream>
+#include <cstdio>
 
 namespace simple_web_game_server {
   // time literals to initialize time-step variables
   using namespace std::chrono_literals;
 
+  // datatype implementations
+  using std::unordered_set;
+
+  /// Actions a game_server may take when a game update exceeds its budget.
+  enum class slow_update_policy {
+    /// Only record the slow update.
+    ignore,
+    /// Skip the game's next tick and pass the skipped time to the update
+    /// after that.
+    defer,
+    /// Skip the game's next tick and drop the skipped time.
+    skip_tick,
+    /// End the game session as though the game were done.
+    terminate
+  };
+
   /// A game server built on the base_server class.
   /**
    * This class wraps base_server
@@ -74,8 +96,33 @@ namespace simple_web_game_server {
       bool disconnection;
     };
 
+    // A running game stored contiguously with its message queues. Slots are
+    // addressed by a stable index and reused once their game is erased.
+    struct game_slot {
+      game_slot(const session_id& s, game_instance&& g, json&& d) :
+        session(s), game(std::move(g)), data(std::move(d)), skip_tick(false),
+        deferred_time(0), terminated(false), handing_off(false) {}
+
+      session_id session;
+      std::optional<game_instance> game;
+      json data;
+      vector<message> in_messages;
+      vector<message> out_messages;
+
+      // state for the slow update policy
+      bool skip_tick;
+      long deferred_time;
+      bool terminated;
+
+      // paused while handoff_games() sends the game to a peer
+      bool handing_off;
+    };
+
   // main class body
   public:
+    /// Counts of the frames written to players and the writes sending them.
+    using write_stats = typename jwt_base_server::write_stats;
+
     ///The constructor for the game_server class.
     /**
      * The parameters are simply used to construct the underlying base_server.
@@ -84,7 +131,8 @@ namespace simple_web_game_server {
         const jwt::verifier<jwt_clock, json_traits>& v,
         function<std::string(const combined_id&, const json&)> f,
         std::chrono::milliseconds t
-      ) : m_jwt_server(v, f, t)
+      ) : m_update_budget(0), m_slow_update_policy(slow_update_policy::ignore),
+          m_slow_update_count(0), m_jwt_server(v, f, t)
     {
       m_jwt_server.set_open_handler(
           bind(
@@ -109,6 +157,13 @@ namespace simple_web_game_server {
             simple_web_game_server::_2
           )
         );
+      m_jwt_server.set_drain_handler(
+          bind(
+            &game_server::is_live_session,
+            this,
+            simple_web_game_server::_1
+          )
+        );
     }
 
     /// Constructs the underlying base_server with a default time-step.
@@ -145,8 +200,13 @@ namespace simple_web_game_server {
 
       {
         lock_guard<mutex> guard(m_game_list_lock);
-        m_games.clear();
-        m_out_messages.clear();
+        m_game_slots.clear();
+        m_slot_indices.clear();
+        m_free_slots.clear();
+      }
+      {
+        lock_guard<mutex> guard(m_live_session_lock);
+        m_live_sessions.clear();
       }
       {
         lock_guard<mutex> guard(m_in_message_list_lock);
@@ -168,6 +228,85 @@ namespace simple_web_game_server {
       return m_jwt_server.is_running();
     }
 
+    /// Stops accepting new game sessions and stops once all games end.
+    /**
+     * Players may still connect to running games, but clients for any other
+     * session are rejected. The update_games() loop keeps running games until
+     * they are done and all players have disconnected, then stops the server.
+     * Progress may be tracked with get_game_count() and get_player_count().
+     */
+    void drain() {
+      {
+        // the update loop checks is_draining() under this lock before it
+        // waits, so the notification below can't be missed
+        lock_guard<mutex> guard(m_connection_update_list_lock);
+        m_jwt_server.drain();
+      }
+      m_game_condition.notify_one();
+    }
+
+    /// Returns whether the server is draining.
+    bool is_draining() {
+      return m_jwt_server.is_draining();
+    }
+
+    /// Sets how often each connection is pinged to measure round trip times.
+    void set_ping_interval(std::chrono::milliseconds interval) {
+      m_jwt_server.set_ping_interval(interval);
+    }
+
+    /// Returns the histogram of ping round trip times of all connections.
+    const latency_histogram& get_rtt_histogram() const {
+      return m_jwt_server.get_rtt_histogram();
+    }
+
+    /// Adds the round trip times of the given player to the given histogram.
+    bool get_player_rtt(const combined_id& id, latency_histogram& rtt_times) {
+      return m_jwt_server.get_player_rtt(id, rtt_times);
+    }
+
+    /// Adds the round trip times of the given session to the given histogram.
+    bool get_session_rtt(const session_id& sid, latency_histogram& rtt_times) {
+      return m_jwt_server.get_session_rtt(sid, rtt_times);
+    }
+
+    /// Returns the frames written to connections and the writes sending them.
+    write_stats get_write_stats() {
+      return m_jwt_server.get_write_stats();
+    }
+
+    /// Sets the time budget for a single game update and the slow policy.
+    /**
+     * Each call to game_instance::update() is timed. Any update taking longer
+     * than budget is counted as slow and the given policy is applied to the
+     * game. A budget of zero disables the policy, though update times are
+     * still recorded.
+     */
+    void set_update_budget(
+        std::chrono::microseconds budget,
+        slow_update_policy policy
+      )
+    {
+      lock_guard<mutex> guard(m_game_list_lock);
+      m_update_budget = budget;
+      m_slow_update_policy = policy;
+    }
+
+    /// Returns the histogram of individual game update times.
+    const latency_histogram& get_update_time_histogram() const {
+      return m_update_times;
+    }
+
+    /// Returns the histogram of whole update_games time-step durations.
+    const latency_histogram& get_tick_time_histogram() const {
+      return m_tick_times;
+    }
+
+    /// Returns the number of game updates that exceeded the update budget.
+    std::size_t get_slow_update_count() const {
+      return m_slow_update_count;
+    }
+
     /// Loop to run games.
     /**
      * Processes player connections and disconnections, executes the
@@ -178,7 +317,7 @@ namespace simple_web_game_server {
      */
     void update_games(std::chrono::milliseconds timestep) {
       auto time_start = clock::now();
-      vector<session_id> finished_games;
+      vector<std::size_t> finished_slots;
 
       while(m_jwt_server.is_running()) {
         const auto delta_time =
@@ -187,11 +326,22 @@ namespace simple_web_game_server {
           );
 
         unique_lock<mutex> game_lock(m_game_list_lock);
-        if(m_games.empty()) {
+        if(m_slot_indices.empty()) {
           game_lock.unlock();
           unique_lock<mutex> conn_lock(m_connection_update_list_lock);
           while(m_connection_updates.empty()) {
-            m_game_condition.wait(conn_lock);
+            if(m_jwt_server.is_draining()) {
+              if(m_jwt_server.get_player_count() == 0) {
+                conn_lock.unlock();
+                spdlog::info("server drained");
+                stop();
+                return;
+              }
+              // disconnections don't notify, so poll for the last players
+              m_game_condition.wait_for(conn_lock, timestep);
+            } else {
+              m_game_condition.wait(conn_lock);
+            }
             if(!m_jwt_server.is_running()) {
               return;
             }
@@ -209,36 +359,37 @@ namespace simple_web_game_server {
 
           // we remove game data here to catch any possible players submitting
           // new connections in the last time-step when the game session ends
-          for(session_id sid : finished_games) {
-            spdlog::trace("erasing game session {}", sid);
-            m_out_messages.erase(sid);
-            m_games.erase(sid);
+          for(std::size_t index : finished_slots) {
+            spdlog::trace(
+                "erasing game session {}", m_game_slots[index].session
+              );
+            free_slot(index);
           }
-          finished_games.clear();
+          finished_slots.clear();
 
           process_game_updates(delta_time.count());
+          m_tick_times.record(clock::now() - time_start);
 
-          for(auto it = m_out_messages.begin(); it != m_out_messages.end();
-              ++it)
-          {
-            for(message& msg : it->second) {
+          for(game_slot& slot : m_game_slots) {
+            for(message& msg : slot.out_messages) {
               m_jwt_server.send_message(
-                  { msg.first, it->first },
+                  { msg.first, slot.session },
                   std::move(msg.second)
                 );
             }
-            it->second.clear();
+            slot.out_messages.clear();
           }
 
-          for(auto it = m_games.begin(); it != m_games.end(); ++it) {
-            if(it->second.is_done()) {
-              spdlog::debug("game session {} ended", it->first);
+          for(std::size_t i = 0; i < m_game_slots.size(); ++i) {
+            game_slot& slot = m_game_slots[i];
+            if(slot.game && (slot.terminated || slot.game->is_done())) {
+              spdlog::debug("game session {} ended", slot.session);
               m_jwt_server.complete_session(
-                  it->first,
-                  it->first,
-                  it->second.get_state()
+                  slot.session,
+                  slot.session,
+                  slot.game->get_state()
                 );
-              finished_games.push_back(it->first);
+              finished_slots.push_back(i);
             }
           }
         }
@@ -248,10 +399,291 @@ namespace simple_web_game_server {
     /// Returns the number of running game sessions.
     std::size_t get_game_count() {
       lock_guard<mutex> guard(m_game_list_lock);
-      return m_games.size();
+      return m_slot_indices.size();
+    }
+
+    /// Hands off all running games to a peer game_server process.
+    /**
+     * Connects to a peer running receive_games() on the local socket
+     * socket_path and sends it the session id, session data, and snapshot of
+     * each running game. Every session the peer restores is completed here
+     * with result_data, so each client is sent a result token built by the
+     * result function given to the constructor, e.g. a fresh token for the
+     * peer, and may reconnect with it. Games being handed off are paused,
+     * and games the peer fails to restore resume here, as do all unconfirmed
+     * games if the peer doesn't reply within timeout.
+     *
+     * Requires game_instance to define the member functions
+     * json get_snapshot() const and void restore(const json&), and json to
+     * be constructible from a session_id.
+     * Returns the number of games handed off.
+     */
+    std::size_t handoff_games(
+        const std::string& socket_path,
+        const json& result_data,
+        std::chrono::milliseconds timeout = std::chrono::seconds{10}
+      )
+    {
+      namespace asio = websocketpp::lib::asio;
+      using local_protocol = asio::local::stream_protocol;
+
+      const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+      vector<std::pair<std::size_t, session_id> > sent_slots;
+      std::string records;
+      {
+        lock_guard<mutex> game_guard(m_game_list_lock);
+        for(std::size_t i = 0; i < m_game_slots.size(); ++i) {
+          game_slot& slot = m_game_slots[i];
+          if(!slot.game || slot.terminated || slot.handing_off
+            || slot.game->is_done())
+          {
+            continue;
+          }
+
+          records += json_traits::serialize(json(slot.session)) + "\n";
+          records += json_traits::serialize(slot.data) + "\n";
+          records += json_traits::serialize(slot.game->get_snapshot()) + "\n";
+          slot.handing_off = true;
+          sent_slots.emplace_back(i, slot.session);
+        }
+      }
+      records += "\n";
+
+      // the socket I/O is done without the game lock, so the other games
+      // keep running while the peer restores the paused ones
+      std::size_t reply_count = 0;
+      vector<bool> restored(sent_slots.size(), false);
+      try {
+        asio::io_service ios;
+        local_protocol::socket socket{ios};
+        run_with_deadline(ios, socket, deadline, "connect",
+            [&](auto handler) {
+              socket.async_connect(
+                  local_protocol::endpoint{socket_path}, handler
+                );
+            }
+          );
+        run_with_deadline(ios, socket, deadline, "write",
+            [&](auto handler) {
+              asio::async_write(socket, asio::buffer(records), handler);
+            }
+          );
+
+        asio::streambuf buffer;
+        std::istream stream{&buffer};
+        for(; reply_count < sent_slots.size(); ++reply_count) {
+          run_with_deadline(ios, socket, deadline, "read",
+              [&](auto handler) {
+                asio::async_read_until(socket, buffer, '\n', handler);
+              }
+            );
+          std::string reply;
+          std::getline(stream, reply);
+          if(reply == "ok") {
+            restored[reply_count] = true;
+          } else {
+            spdlog::error(
+                "peer failed to restore game session {}",
+                sent_slots[reply_count].second
+              );
+          }
+        }
+      } catch(std::exception& e) {
+        // games the peer confirmed before the error now run there
+        spdlog::error(
+            "error handing off games after {} of {} replies: {}",
+            reply_count, sent_slots.size(), e.what()
+          );
+      }
+
+      std::size_t handoff_count = 0;
+      lock_guard<mutex> game_guard(m_game_list_lock);
+      for(std::size_t i = 0; i < sent_slots.size(); ++i) {
+        // the server may have been stopped while the lock was released
+        auto index_it = m_slot_indices.find(sent_slots[i].second);
+        if(index_it == m_slot_indices.end()
+          || index_it->second != sent_slots[i].first)
+        {
+          continue;
+        }
+
+        std::size_t index = index_it->second;
+        m_game_slots[index].handing_off = false;
+        if(restored[i]) {
+          spdlog::debug("game session {} handed off", sent_slots[i].second);
+          m_jwt_server.complete_session(
+              sent_slots[i].second,
+              sent_slots[i].second,
+              result_data
+            );
+          free_slot(index);
+          ++handoff_count;
+        }
+      }
+
+      return handoff_count;
+    }
+
+    /// Accepts games handed off by a peer game_server process.
+    /**
+     * Listens on the local socket socket_path for a single peer calling
+     * handoff_games(), reconstructs each game from its session data, and
+     * restores it from its snapshot. Restored games wait for their players to
+     * reconnect. Blocks until the handoff is complete, or until timeout
+     * passes without the peer connecting and sending all of its games, and
+     * returns the number of games restored. The requirements on game_instance
+     * and json are those of handoff_games().
+     */
+    std::size_t receive_games(
+        const std::string& socket_path,
+        std::chrono::milliseconds timeout = std::chrono::seconds{60}
+      )
+    {
+      namespace asio = websocketpp::lib::asio;
+      using local_protocol = asio::local::stream_protocol;
+
+      const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+      std::size_t restored_count = 0;
+      try {
+        asio::io_service ios;
+        std::remove(socket_path.c_str());
+        local_protocol::acceptor acceptor{
+            ios, local_protocol::endpoint{socket_path}
+          };
+        local_protocol::socket socket{ios};
+        run_with_deadline(ios, acceptor, deadline, "accept",
+            [&](auto handler) { acceptor.async_accept(socket, handler); }
+          );
+        std::remove(socket_path.c_str());
+
+        // every record is read before any game is restored, so a peer that
+        // stalls partway keeps all of its games
+        asio::streambuf buffer;
+        std::istream stream{&buffer};
+        auto read_line = [&]() {
+            run_with_deadline(ios, socket, deadline, "read",
+                [&](auto handler) {
+                  asio::async_read_until(socket, buffer, '\n', handler);
+                }
+              );
+            std::string line;
+            std::getline(stream, line);
+            return line;
+          };
+
+        vector<std::string> fields;
+        for(std::string sid_str = read_line(); !sid_str.empty();
+          sid_str = read_line())
+        {
+          fields.push_back(std::move(sid_str));
+          fields.push_back(read_line());
+          fields.push_back(read_line());
+        }
+
+        std::string replies;
+        for(std::size_t i = 0; i < fields.size(); i += 3) {
+          if(restore_game(fields[i], fields[i+1], fields[i+2])) {
+            replies += "ok\n";
+            ++restored_count;
+          } else {
+            replies += "fail\n";
+          }
+        }
+
+        run_with_deadline(ios, socket, deadline, "write",
+            [&](auto handler) {
+              asio::async_write(socket, asio::buffer(replies), handler);
+            }
+          );
+      } catch(std::exception& e) {
+        spdlog::error("error receiving games: {}", e.what());
+        std::remove(socket_path.c_str());
+      }
+
+      return restored_count;
     }
 
   private:
+    // starts a single asynchronous operation on ios with the given function
+    // and runs ios until it completes, closing io_object to cancel the
+    // operation if deadline passes first; throws if it fails or times out
+    template<typename io_object, typename start_function>
+    static void run_with_deadline(
+        websocketpp::lib::asio::io_service& ios,
+        io_object& object,
+        std::chrono::steady_clock::time_point deadline,
+        const char* operation,
+        start_function start
+      )
+    {
+      bool done = false;
+      websocketpp::lib::asio::error_code ec;
+      start([&](const websocketpp::lib::asio::error_code& e, auto&&...) {
+          done = true;
+          ec = e;
+        });
+
+      ios.restart();
+      ios.run_until(deadline);
+      if(!done) {
+        websocketpp::lib::asio::error_code ignored;
+        object.close(ignored);
+        ios.restart();
+        ios.run();
+        throw std::runtime_error{std::string{operation} + " timed out"};
+      }
+      if(ec) {
+        throw std::runtime_error{std::string{operation} + ": " + ec.message()};
+      }
+    }
+
+    // reconstructs a single game sent by a peer's handoff_games()
+    bool restore_game(
+        const std::string& sid_str,
+        const std::string& data_str,
+        const std::string& snapshot_str
+      )
+    {
+      try {
+        json sid_json, data, snapshot;
+        json_traits::parse(sid_json, sid_str);
+        json_traits::parse(data, data_str);
+        json_traits::parse(snapshot, snapshot_str);
+        session_id sid =
+          game_instance::player_traits::parse_session_id(sid_json);
+
+        game_instance game{data};
+        if(!game.is_valid()) {
+          spdlog::error("peer sent invalid game data for session {}", sid);
+          return false;
+        }
+        game.restore(snapshot);
+
+        lock_guard<mutex> game_guard(m_game_list_lock);
+        if(m_slot_indices.count(sid) > 0) {
+          spdlog::error("peer sent game session {} already running", sid);
+          return false;
+        }
+
+        spdlog::debug("restoring game session {}", sid);
+        m_slot_indices.emplace(
+            sid, allocate_slot(sid, std::move(game), std::move(data))
+          );
+        return true;
+      } catch(std::exception& e) {
+        spdlog::error("error restoring game from peer: {}", e.what());
+        return false;
+      }
+    }
+
+    // used by the base_server to decide who may connect while draining
+    bool is_live_session(const session_id& sid) {
+      lock_guard<mutex> guard(m_live_session_lock);
+      return m_live_sessions.count(sid) > 0;
+    }
+
     void process_connection_updates() {
       vector<connection_update> connection_updates;
       {
@@ -260,18 +692,15 @@ namespace simple_web_game_server {
       }
 
       for(connection_update& update : connection_updates) {
-        auto games_it = m_games.find(update.id.session);
-        auto out_messages_it = m_out_messages.find(update.id.session);
+        auto index_it = m_slot_indices.find(update.id.session);
 
         if(update.disconnection) {
-          if(games_it != m_games.end()) {
-            games_it->second.disconnect(
-                out_messages_it->second,
-                update.id.player
-              );
+          if(index_it != m_slot_indices.end()) {
+            game_slot& slot = m_game_slots[index_it->second];
+            slot.game->disconnect(slot.out_messages, update.id.player);
           }
         } else {
-          if(games_it == m_games.end()) {
+          if(index_it == m_slot_indices.end()) {
             game_instance game{update.data};
 
             if(!game.is_valid()) {
@@ -283,51 +712,160 @@ namespace simple_web_game_server {
             }
 
             spdlog::debug("creating game session {}", update.id.session);
-            games_it = m_games.emplace(
-                update.id.session, std::move(game)
-              ).first;
-            out_messages_it = m_out_messages.emplace(
-                update.id.session, vector<message>{}
+            index_it = m_slot_indices.emplace(
+                update.id.session,
+                allocate_slot(
+                  update.id.session,
+                  std::move(game),
+                  std::move(update.data)
+                )
               ).first;
           }
-     
-          games_it->second.connect(out_messages_it->second, update.id.player);
+
+          game_slot& slot = m_game_slots[index_it->second];
+          slot.game->connect(slot.out_messages, update.id.player);
         }
       }
     }
 
+    // places a new game in a free slot, or at the end of m_game_slots if
+    // there are none, and returns the slot index
+    std::size_t allocate_slot(
+        const session_id& sid,
+        game_instance&& game,
+        json&& data
+      )
+    {
+      {
+        lock_guard<mutex> guard(m_live_session_lock);
+        m_live_sessions.insert(sid);
+      }
+
+      if(m_free_slots.empty()) {
+        m_game_slots.emplace_back(sid, std::move(game), std::move(data));
+        return m_game_slots.size() - 1;
+      }
+
+      std::size_t index = m_free_slots.back();
+      m_free_slots.pop_back();
+
+      game_slot& slot = m_game_slots[index];
+      slot.session = sid;
+      slot.game.emplace(std::move(game));
+      slot.data = std::move(data);
+      return index;
+    }
+
+    // destroys the game in the given slot and marks the slot for reuse
+    void free_slot(std::size_t index) {
+      game_slot& slot = m_game_slots[index];
+      m_slot_indices.erase(slot.session);
+      {
+        lock_guard<mutex> guard(m_live_session_lock);
+        m_live_sessions.erase(slot.session);
+      }
+      slot.game.reset();
+      slot.data = json{};
+      slot.in_messages.clear();
+      slot.out_messages.clear();
+      slot.skip_tick = false;
+      slot.deferred_time = 0;
+      slot.terminated = false;
+      slot.handing_off = false;
+      m_free_slots.push_back(index);
+    }
+
     void process_game_updates(long delta_time) {
       unordered_map<session_id, vector<message>, id_hash> in_messages;
-      in_messages.reserve(m_games.size());
       {
         lock_guard<mutex> msg_guard(m_in_message_list_lock);
         std::swap(in_messages, m_in_messages);
       }
 
+      // hand each batch of messages to its slot so the update loop below
+      // is a linear scan with no further lookups
+      for(auto& in_msg_pair : in_messages) {
+        auto index_it = m_slot_indices.find(in_msg_pair.first);
+        if(index_it != m_slot_indices.end()) {
+          vector<message>& slot_messages =
+            m_game_slots[index_it->second].in_messages;
+
+          // a game that skipped a tick may still hold earlier messages
+          if(slot_messages.empty()) {
+            std::swap(slot_messages, in_msg_pair.second);
+          } else {
+            std::move(
+                in_msg_pair.second.begin(),
+                in_msg_pair.second.end(),
+                std::back_inserter(slot_messages)
+              );
+          }
+        }
+      }
+
       // game updates are completely independent, so exec in parallel
       std::for_each(
           std::execution::par,
-          m_games.begin(),
-          m_games.end(),
-          [&](auto& key_val_pair){
-            auto in_msg_it = in_messages.find(key_val_pair.first);
-            if(in_msg_it != in_messages.end()) {
-              key_val_pair.second.update(
-                  m_out_messages.at(key_val_pair.first),
-                  in_msg_it->second,
-                  delta_time
-                );
-            } else {
-              key_val_pair.second.update(
-                  m_out_messages.at(key_val_pair.first),
-                  vector<message>{},
-                  delta_time
-                );
+          m_game_slots.begin(),
+          m_game_slots.end(),
+          [&](game_slot& slot){
+            if(slot.game && !slot.terminated && !slot.handing_off) {
+              update_slot(slot, delta_time);
             }
           }
         );
     }
 
+    // runs a single game update, timing it and applying the slow policy
+    void update_slot(game_slot& slot, long delta_time) {
+      if(slot.skip_tick) {
+        slot.skip_tick = false;
+        if(m_slow_update_policy == slow_update_policy::defer) {
+          slot.deferred_time += delta_time;
+        }
+        return;
+      }
+
+      const auto update_start = clock::now();
+      slot.game->update(
+          slot.out_messages,
+          slot.in_messages,
+          delta_time + slot.deferred_time
+        );
+      const auto update_time = clock::now() - update_start;
+
+      slot.in_messages.clear();
+      slot.deferred_time = 0;
+      m_update_times.record(update_time);
+
+      if(m_update_budget.count() > 0 && update_time > m_update_budget) {
+        ++m_slow_update_count;
+        spdlog::debug(
+            "game session {} update took {}us",
+            slot.session,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+              update_time
+            ).count()
+          );
+
+        switch(m_slow_update_policy) {
+          case slow_update_policy::defer:
+          case slow_update_policy::skip_tick:
+            slot.skip_tick = true;
+            break;
+          case slow_update_policy::terminate:
+            spdlog::error(
+                "terminating game session {}: update over budget",
+                slot.session
+              );
+            slot.terminated = true;
+            break;
+          case slow_update_policy::ignore:
+            break;
+        }
+      }
+    }
+
     void process_message(const combined_id& id, std::string&& data) {
       lock_guard<mutex> msg_guard(m_in_message_list_lock);
       m_in_messages[id.session].emplace_back(
@@ -351,13 +889,19 @@ namespace simple_web_game_server {
     }
 
     // member variables
-    unordered_map<
-        session_id,
-        game_instance,
-        id_hash
-      > m_games;
+    vector<game_slot> m_game_slots;
+    unordered_map<session_id, std::size_t, id_hash> m_slot_indices;
+    vector<std::size_t> m_free_slots;
+
+    // m_game_list_lock guards the members m_game_slots, m_slot_indices, and
+    // m_free_slots
     mutex m_game_list_lock;
 
+    // a copy of the keys of m_slot_indices with its own lock, so the
+    // base_server may check it without waiting on the update loop
+    unordered_set<session_id, id_hash> m_live_sessions;
+    mutex m_live_session_lock;
+
     unordered_map<
         session_id,
         vector<message>,
@@ -370,7 +914,13 @@ namespace simple_web_game_server {
 
     condition_variable m_game_condition;
 
-    unordered_map<session_id, vector<message>, id_hash> m_out_messages;
+    // the update budget and policy are guarded by m_game_list_lock
+    std::chrono::microseconds m_update_budget;
+    slow_update_policy m_slow_update_policy;
+
+    latency_histogram m_update_times;
+    latency_histogram m_tick_times;
+    atomic<std::size_t> m_slow_update_count;
 
     jwt_base_server m_jwt_server;
   };
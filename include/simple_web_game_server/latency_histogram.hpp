@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_LATENCY_HISTOGRAM_HPP
+#define JWT_GAME_SERVER_LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace simple_web_game_server {
+  /// A fixed size, log-linear histogram of durations.
+  /**
+   * Durations are recorded in microseconds into buckets whose width is at
+   * most 1/8 of their lower bound, so reported percentiles are within 12.5%
+   * of the true value. Recording is lock free and may be done concurrently
+   * from any number of threads; reads taken while other threads record are
+   * approximate.
+   */
+  class latency_histogram {
+  private:
+    static constexpr unsigned int sub_bucket_bits = 3;
+    static constexpr unsigned int sub_bucket_count = 1u << sub_bucket_bits;
+    static constexpr unsigned int max_exponent = 40;
+    static constexpr std::size_t bucket_count =
+      sub_bucket_count * (max_exponent - sub_bucket_bits + 2);
+
+  public:
+    /// The type of the durations stored in the histogram.
+    using duration = std::chrono::microseconds;
+
+    latency_histogram() : m_count(0), m_sum(0), m_max(0) {
+      for(auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    /// Records a single duration.
+    template<typename rep, typename period>
+    void record(std::chrono::duration<rep, period> d) {
+      const std::uint64_t us = to_micros(d);
+
+      m_buckets[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+      m_count.fetch_add(1, std::memory_order_relaxed);
+      m_sum.fetch_add(us, std::memory_order_relaxed);
+
+      std::uint64_t prev_max = m_max.load(std::memory_order_relaxed);
+      while(us > prev_max && !m_max.compare_exchange_weak(
+            prev_max, us, std::memory_order_relaxed
+          ))
+      {}
+    }
+
+    /// Returns the number of recorded durations.
+    std::uint64_t count() const {
+      return m_count.load(std::memory_order_relaxed);
+    }
+
+    /// Returns the largest recorded duration.
+    duration max() const {
+      return from_micros(m_max.load(std::memory_order_relaxed));
+    }
+
+    /// Returns the mean of the recorded durations.
+    duration mean() const {
+      const std::uint64_t n = count();
+      if(n == 0) {
+        return duration{ 0 };
+      }
+      return from_micros(m_sum.load(std::memory_order_relaxed) / n);
+    }
+
+    /// Returns an upper bound on the given percentile, p in [0, 100].
+    duration percentile(double p) const {
+      const std::uint64_t n = count();
+      if(n == 0) {
+        return duration{ 0 };
+      }
+
+      std::uint64_t rank = static_cast<std::uint64_t>(p / 100.0 * n);
+      if(rank >= n) {
+        rank = n - 1;
+      }
+
+      std::uint64_t seen = 0;
+      for(std::size_t i = 0; i < bucket_count; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if(seen > rank) {
+          return from_micros(std::min(
+              bucket_upper_bound(i),
+              m_max.load(std::memory_order_relaxed)
+            ));
+        }
+      }
+
+      return max();
+    }
+
+    /// Adds all durations recorded in another histogram to this one.
+    void merge(const latency_histogram& other) {
+      for(std::size_t i = 0; i < bucket_count; ++i) {
+        m_buckets[i].fetch_add(
+            other.m_buckets[i].load(std::memory_order_relaxed),
+            std::memory_order_relaxed
+          );
+      }
+      m_count.fetch_add(other.count(), std::memory_order_relaxed);
+      m_sum.fetch_add(
+          other.m_sum.load(std::memory_order_relaxed),
+          std::memory_order_relaxed
+        );
+
+      const std::uint64_t other_max =
+        other.m_max.load(std::memory_order_relaxed);
+      std::uint64_t prev_max = m_max.load(std::memory_order_relaxed);
+      while(other_max > prev_max && !m_max.compare_exchange_weak(
+            prev_max, other_max, std::memory_order_relaxed
+          ))
+      {}
+    }
+
+    /// Clears all recorded durations.
+    void clear() {
+      for(auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+      m_count.store(0, std::memory_order_relaxed);
+      m_sum.store(0, std::memory_order_relaxed);
+      m_max.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    template<typename rep, typename period>
+    static std::uint64_t to_micros(std::chrono::duration<rep, period> d) {
+      const auto us = std::chrono::duration_cast<duration>(d).count();
+      return us > 0 ? static_cast<std::uint64_t>(us) : 0;
+    }
+
+    static duration from_micros(std::uint64_t us) {
+      return duration{ static_cast<duration::rep>(us) };
+    }
+
+    // values below sub_bucket_count get a bucket each, above that each
+    // power of two is split into sub_bucket_count linear buckets
+    static std::size_t bucket_index(std::uint64_t us) {
+      if(us < sub_bucket_count) {
+        return us;
+      }
+
+      unsigned int exponent = sub_bucket_bits;
+      while((us >> (exponent + 1)) > 0) {
+        ++exponent;
+      }
+      if(exponent > max_exponent) {
+        return bucket_count - 1;
+      }
+
+      const unsigned int shift = exponent - sub_bucket_bits;
+      const std::size_t sub_bucket = (us >> shift) - sub_bucket_count;
+      return sub_bucket_count * (shift + 1) + sub_bucket;
+    }
+
+    static std::uint64_t bucket_upper_bound(std::size_t index) {
+      if(index < sub_bucket_count) {
+        return index;
+      }
+
+      const std::size_t shift = index / sub_bucket_count - 1;
+      const std::uint64_t sub_bucket = index % sub_bucket_count;
+      return ((sub_bucket_count + sub_bucket + 1) << shift) - 1;
+    }
+
+    std::array<std::atomic<std::uint64_t>, bucket_count> m_buckets;
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_sum;
+    std::atomic<std::uint64_t> m_max;
+  };
+}
+
+#endif // JWT_GAME_SERVER_LATENCY_HISTOGRAM_HPP
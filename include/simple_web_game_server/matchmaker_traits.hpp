@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_MATCHMAKER_TRAITS_HPP
+#define JWT_GAME_SERVER_MATCHMAKER_TRAITS_HPP
+
+#include <type_traits>
+#include <utility>
+
+namespace simple_web_game_server {
+  /// Detects whether a matchmaker maintains its own index of sessions.
+  /**
+   * An incremental matchmaker defines the member functions
+   *
+   *     void on_join(const session_id&, const session_data&);
+   *     void on_leave(const session_id&);
+   *     bool can_match();
+   *     void match(vector<game>&, vector<message>&, long delta_time);
+   *
+   * in place of the can_match and match functions taking the map of all
+   * queued sessions. The matchmaking_server calls on_join once for each
+   * valid session entering the queue and on_leave for each session leaving
+   * it without being matched; sessions returned in a game from match must be
+   * removed from the index by the matchmaker itself. Since on_leave may still
+   * be called for a session the matchmaker has just matched, it should ignore
+   * unknown session ids.
+   */
+  template<typename matchmaker, typename = void>
+  struct is_incremental_matchmaker : std::false_type {};
+
+  template<typename matchmaker>
+  struct is_incremental_matchmaker<
+      matchmaker,
+      std::void_t<decltype(
+        std::declval<matchmaker&>().on_leave(
+          std::declval<
+            const typename matchmaker::player_traits::id::session_id&
+          >()
+        )
+      )>
+    > : std::true_type {};
+
+  /// Detects whether an incremental matchmaker accepts prior wait times.
+  /**
+   * Such a matchmaker defines
+   *
+   *     void on_join(const session_id&, const session_data&, long waited);
+   *
+   * which is called for sessions restored by
+   * matchmaking_server::restore_queue with the milliseconds they had already
+   * waited, so time based rules treat them as having joined that long ago.
+   */
+  template<typename matchmaker, typename = void>
+  struct accepts_join_wait_time : std::false_type {};
+
+  template<typename matchmaker>
+  struct accepts_join_wait_time<
+      matchmaker,
+      std::void_t<decltype(
+        std::declval<matchmaker&>().on_join(
+          std::declval<
+            const typename matchmaker::player_traits::id::session_id&
+          >(),
+          std::declval<const typename matchmaker::session_data&>(),
+          0L
+        )
+      )>
+    > : std::true_type {};
+}
+
+#endif // JWT_GAME_SERVER_MATCHMAKER_TRAITS_HPP
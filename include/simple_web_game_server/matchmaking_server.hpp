@@ -24,11 +24,21 @@
 #define JWT_GAME_SERVER_MATCHMAKING_SERVER_HPP
 
 #include "base_server.hpp"
+#include "matchmaker_traits.hpp"
+#include "queue_log.hpp"
 
 #include <unordered_set>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <execution>
 #include <functional>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <string>
 #include <tuple>
+#include <type_traits>
 
 namespace simple_web_game_server {
   // Time literals to initialize timestep variables
@@ -41,6 +51,15 @@ namespace simple_web_game_server {
   /**
    * This class wraps an underlying base_server
    * and performs matchmaking between connected client sessions.
+   * The matchmaker may either be given the map of all queued sessions each
+   * time-step or be incremental, see is_incremental_matchmaker.
+   *
+   * Sessions may be partitioned into independent queues, e.g. by game mode
+   * or region, see set_queue_key_function. Each queue has its own matchmaker
+   * and the queues are matched in parallel.
+   *
+   * The queues may be persisted to a log so that a restarted server keeps
+   * the place of sessions whose players reconnect, see restore_queue.
    */
   template<typename matchmaker, typename jwt_clock, typename json_traits,
     typename server_config, typename close_reasons = default_close_reasons>
@@ -69,6 +88,47 @@ namespace simple_web_game_server {
 
     using ssl_context_ptr = typename jwt_base_server::ssl_context_ptr;
 
+    using session_log = queue_log<session_id, json, id_hash>;
+    using wall_clock = std::chrono::system_clock;
+
+    /// The matchmaker and queued sessions for a single queue key.
+    struct match_queue {
+      explicit match_queue(const std::string& k)
+        : key(k), mm(make_matchmaker(k)), match_rate(0) {}
+
+      std::string key;
+      matchmaker mm;
+      unordered_map<session_id, session_data, id_hash> sessions;
+      vector<game> games;
+      vector<message> messages;
+
+      // unmatched sessions in the order they joined
+      std::list<session_id> order;
+      // moving average of sessions matched per second
+      double match_rate;
+    };
+
+    /// The queue of a session and its position in the queue's join order.
+    struct queue_entry {
+      queue_entry(
+          match_queue* q,
+          typename std::list<session_id>::iterator o,
+          typename wall_clock::time_point t
+        ) : queue(q), order_it(o), join_time(t), is_restored(false),
+          last_position(0) {}
+
+      match_queue* queue;
+      typename std::list<session_id>::iterator order_it;
+      typename wall_clock::time_point join_time;
+
+      // restored from the queue log and waiting for a player to reconnect
+      bool is_restored;
+
+      // the status last sent to the session, position zero if none
+      std::size_t last_position;
+      std::optional<std::chrono::milliseconds> last_estimate;
+    };
+
     /// The data associated to a connecting or disconnecting client.
     struct connection_update {
       connection_update(const combined_id& i) : id(i),
@@ -83,6 +143,19 @@ namespace simple_web_game_server {
 
   // main class body
   public:
+    /// Counts of the frames written to players and the writes sending them.
+    using write_stats = typename jwt_base_server::write_stats;
+
+    /// The queue status of a session, see set_queue_status_interval.
+    struct queue_status {
+      /// The position of the session in its queue, starting from 1.
+      std::size_t position;
+      /// The number of sessions in the queue.
+      std::size_t queue_size;
+      /// The expected wait, if any sessions have been matched recently.
+      std::optional<std::chrono::milliseconds> estimated_wait;
+    };
+
     /// The constructor for the matchmaking_server class.
     /**
      * The parameters are
@@ -92,7 +165,10 @@ namespace simple_web_game_server {
         const jwt::verifier<jwt_clock, json_traits>& v,
         function<std::string(const combined_id&, const json&)> f,
         std::chrono::milliseconds t
-      ) : m_jwt_server{v, f, t}
+      ) : m_get_queue_key{[](const json&) { return std::string{}; }},
+        m_status_interval{0},
+        m_format_status{&matchmaking_server::format_queue_status},
+        m_jwt_server{v, f, t}
     {
       m_jwt_server.set_open_handler(
           bind(
@@ -151,9 +227,21 @@ namespace simple_web_game_server {
       m_jwt_server.stop();
       {
         lock_guard<mutex> guard(m_match_lock);
-        m_session_data.clear();
+        for(match_queue* queue : m_queue_list) {
+          if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+            for(auto& session_pair : queue->sessions) {
+              queue->mm.on_leave(session_pair.first);
+            }
+          }
+          queue->sessions.clear();
+          queue->order.clear();
+        }
+        m_session_queues.clear();
         m_session_players.clear();
+        m_restored_sessions.clear();
         m_connection_updates.clear();
+        // the log is kept so that a restarted server may restore the queue
+        m_queue_log.close();
       }
       m_match_condition.notify_one();
     }
@@ -167,6 +255,180 @@ namespace simple_web_game_server {
       return m_jwt_server.is_running();
     }
 
+    /// Stops accepting new sessions and stops once the queue is empty.
+    /**
+     * Clients for sessions without connected players are rejected. Queued
+     * sessions continue to be matched; once the matchmaker can no longer
+     * match the remaining sessions they are cancelled and the match_players()
+     * loop stops the server after all players have disconnected. Progress may
+     * be tracked with get_player_count().
+     */
+    void drain() {
+      {
+        // the update loop checks is_draining() under this lock before it
+        // waits, so the notification below can't be missed
+        lock_guard<mutex> guard(m_connection_update_list_lock);
+        m_jwt_server.drain();
+      }
+      m_match_condition.notify_one();
+    }
+
+    /// Returns whether the server is draining.
+    bool is_draining() {
+      return m_jwt_server.is_draining();
+    }
+
+    /// Sets how often each connection is pinged to measure round trip times.
+    void set_ping_interval(std::chrono::milliseconds interval) {
+      m_jwt_server.set_ping_interval(interval);
+    }
+
+    /// Returns the histogram of ping round trip times of all connections.
+    const latency_histogram& get_rtt_histogram() const {
+      return m_jwt_server.get_rtt_histogram();
+    }
+
+    /// Adds the round trip times of the given player to the given histogram.
+    bool get_player_rtt(const combined_id& id, latency_histogram& rtt_times) {
+      return m_jwt_server.get_player_rtt(id, rtt_times);
+    }
+
+    /// Adds the round trip times of the given session to the given histogram.
+    bool get_session_rtt(const session_id& sid, latency_histogram& rtt_times) {
+      return m_jwt_server.get_session_rtt(sid, rtt_times);
+    }
+
+    /// Returns the frames written to connections and the writes sending them.
+    write_stats get_write_stats() {
+      return m_jwt_server.get_write_stats();
+    }
+
+    /// Sets the function assigning a session to a queue by its login data.
+    /**
+     * Sessions are only matched with sessions in the same queue. By default
+     * every session is placed in the single queue with the empty key. A
+     * session whose data causes the function to throw is cancelled.
+     *
+     * Each queue has its own matchmaker, constructed from the queue key if
+     * the matchmaker has a constructor taking a const std::string& and
+     * default constructed otherwise. Matchmakers for different queues are
+     * called concurrently, so must not share state without synchronization,
+     * and must return game session ids that are unique across all queues.
+     */
+    void set_queue_key_function(function<std::string(const json&)> f) {
+      lock_guard<mutex> guard(m_match_lock);
+      m_get_queue_key = f;
+    }
+
+    /// Returns the number of queues that have been created.
+    std::size_t get_queue_count() {
+      lock_guard<mutex> guard(m_match_lock);
+      return m_queue_list.size();
+    }
+
+    /// Periodically sends each queued session its position in the queue.
+    /**
+     * At most once every interval, each session whose position in its queue
+     * has changed, or whose estimated wait has changed by more than a fifth,
+     * since it was last sent one is sent a status message, built by the
+     * function given to set_queue_status_function. Positions
+     * count sessions in the order they joined, and the estimated wait is
+     * derived from a moving average of the rate at which the queue's
+     * sessions have been matched over roughly the last minute. All status
+     * messages of a round are submitted to the server as a single batch. An
+     * interval of zero, the default, disables status messages.
+     */
+    void set_queue_status_interval(std::chrono::milliseconds interval) {
+      lock_guard<mutex> guard(m_match_lock);
+      m_status_interval = interval;
+    }
+
+    /// Sets the function building queue status messages.
+    /**
+     * By default the message is the JSON object
+     *
+     *     { "type": "queue_status", "position": p, "queue_size": n,
+     *       "estimated_wait": ms }
+     *
+     * with a null estimated wait if no recent match rate is known.
+     */
+    void set_queue_status_function(
+        function<std::string(const queue_status&)> f
+      )
+    {
+      lock_guard<mutex> guard(m_match_lock);
+      m_format_status = f;
+    }
+
+    /// Restores the queues from a log and keeps the log from then on.
+    /**
+     * Must be called before the server is run. Every session recorded as
+     * queued in the log at the given path is put back in its queue in the
+     * order it originally joined, keeping the time it joined, but is only
+     * given to the matchmaker once one of its players reconnects, so games
+     * are never formed for players who do not come back. Restored sessions
+     * count towards the queue positions of sessions behind them, and
+     * matchmakers that accept wait times are told how long a reconnected
+     * session has already waited, see accepts_join_wait_time. Restored
+     * sessions without a player after the grace period are cancelled.
+     *
+     * From then on each session joining or leaving a queue is appended to
+     * the log once per time-step, and the log is compacted whenever it grows
+     * to more than twice the number of queued sessions, so reading it back
+     * on a restart takes time proportional to the queue. A missing log is
+     * treated as empty. The log is left in place by stop(), and emptied once
+     * a draining server cancels its remaining sessions.
+     */
+    void restore_queue(
+        const std::string& path,
+        std::chrono::milliseconds grace_period
+      )
+    {
+      if(m_jwt_server.is_running()) {
+        throw typename jwt_base_server::server_error{
+            "restore_queue called on running server"
+          };
+      }
+
+      lock_guard<mutex> guard(m_match_lock);
+      vector<typename session_log::entry> entries = session_log::load(path);
+      for(const typename session_log::entry& e : entries) {
+        if(m_session_queues.count(e.sid) > 0) {
+          continue;
+        }
+        match_queue& queue = get_queue(e.key);
+        queue.order.push_back(e.sid);
+        auto it = m_session_queues.emplace(
+            e.sid,
+            queue_entry{ &queue, std::prev(queue.order.end()), e.join_time }
+          ).first;
+        it->second.is_restored = true;
+        m_restored_sessions.push_back(e.sid);
+      }
+      m_restore_deadline = clock::now() + grace_period;
+
+      m_queue_log.open(path, queued_entries());
+      spdlog::info(
+          "restored {} queued sessions from {}", entries.size(), path
+        );
+    }
+
+    /// Calls the given function with the key and matchmaker of each queue.
+    /**
+     * Intended for reading statistics kept by the matchmakers. The function
+     * is called while matching is paused, so must not call back into the
+     * server.
+     */
+    void for_each_matchmaker(
+        function<void(const std::string&, const matchmaker&)> f
+      )
+    {
+      lock_guard<mutex> guard(m_match_lock);
+      for(auto& queue_pair : m_queues) {
+        f(queue_pair.first, queue_pair.second.mm);
+      }
+    }
+
     /// Loop to match players.
     /**
      * Processes client connections and disconnections and matches connected
@@ -177,19 +439,52 @@ namespace simple_web_game_server {
     void match_players(std::chrono::milliseconds timestep) {
       auto time_start = clock::now();
       vector<session_id> finished_sessions;
+      vector<game> games;
 
       while(m_jwt_server.is_running()) {
         unique_lock<mutex> match_lock(m_match_lock);
 
-        if(!m_matchmaker.can_match(m_session_data)) {
+        if(!can_match()) {
+          // only cancel once, since each cancel rewrites the queue log
+          if(m_jwt_server.is_draining() && has_sessions()) {
+            cancel_sessions();
+          }
+          const bool status_pending = m_status_interval.count() > 0
+            && !m_session_queues.empty();
+          const bool restore_pending = !m_restored_sessions.empty();
+          const auto restore_deadline = m_restore_deadline;
           match_lock.unlock();
           unique_lock<mutex> conn_lock(m_connection_update_list_lock);
           while(m_connection_updates.empty()) {
+            if(m_jwt_server.is_draining()) {
+              if(m_jwt_server.get_player_count() == 0) {
+                conn_lock.unlock();
+                spdlog::info("server drained");
+                stop();
+                return;
+              }
+              // recheck the queue while cancelled players disconnect
+              m_match_condition.wait_for(conn_lock, timestep);
+              break;
+            }
+            if(status_pending) {
+              // wake in time to send out changed queue positions
+              m_match_condition.wait_for(conn_lock, m_status_interval);
+              break;
+            }
+            if(restore_pending) {
+              // wake to cancel restored sessions that did not reconnect
+              m_match_condition.wait_until(conn_lock, restore_deadline);
+              break;
+            }
             m_match_condition.wait(conn_lock);
             if(!m_jwt_server.is_running()) {
               return;
             }
           }
+          if(!m_jwt_server.is_running()) {
+            return;
+          }
           match_lock.lock();
         }
 
@@ -201,7 +496,12 @@ namespace simple_web_game_server {
 
         if(delta_time < timestep) {
           match_lock.unlock();
-          std::this_thread::sleep_for(std::min(1us, timestep-delta_time+1us));
+          // block until the next time-step; connection updates, stop(), and
+          // drain() wake the loop early, after which the time is rechecked
+          unique_lock<mutex> conn_lock(m_connection_update_list_lock);
+          if(m_jwt_server.is_running()) {
+            m_match_condition.wait_for(conn_lock, timestep - delta_time);
+          }
         } else {
           time_start = clock::now();
           {
@@ -212,50 +512,353 @@ namespace simple_web_game_server {
             // connections in the last timestep when the session ends
             for(const session_id& sid : finished_sessions) {
               spdlog::trace("erasing data for session {}", sid);
-              m_session_data.erase(sid);
-              m_session_players.erase(sid);
+              erase_session(sid);
             }
 
             std::swap(finished_sessions, new_finished_sessions);
           }
 
-          vector<game> games;
+          if(!m_restored_sessions.empty()
+              && time_start >= m_restore_deadline)
           {
-            vector<pair<session_id, std::string> > messages;
-            m_matchmaker.match(games, messages, m_session_data, dt_count);
+            cancel_restored_sessions();
+          }
 
-            for(message& msg : messages) {
+          match(dt_count);
+
+          vector<pair<combined_id, std::string> > out_messages;
+          for(match_queue* queue : m_queue_list) {
+            for(message& msg : queue->messages) {
               auto session_players_it = m_session_players.find(msg.first);
               if(session_players_it != m_session_players.end()) {
                 for(player_id pid : session_players_it->second) {
-                  m_jwt_server.send_message(
-                      { pid, msg.first }, std::move(msg.second)
+                  out_messages.emplace_back(
+                      combined_id{ pid, msg.first }, msg.second
                     );
                 }
               }
             }
-          }
- 
-          for(game& g : games) {
-            vector<session_id> sessions;
-            session_id game_sid;
-            json game_data;
-            std::tie(sessions, game_sid, game_data) = std::move(g);
+            queue->messages.clear();
 
-            spdlog::trace("matched game: {}", game_data.dump());
+            std::size_t matched_count = 0;
+            for(game& g : queue->games) {
+              spdlog::trace("matched game: {}", std::get<2>(g).dump());
 
-            for(session_id& sid : sessions) {
-              m_jwt_server.complete_session(
-                  sid, game_sid, game_data
-                );
-              finished_sessions.push_back(sid);
+              for(const session_id& sid : std::get<0>(g)) {
+                leave_order(sid);
+                finished_sessions.push_back(sid);
+              }
+              matched_count += std::get<0>(g).size();
+              games.push_back(std::move(g));
             }
+            queue->games.clear();
+
+            update_match_rate(*queue, matched_count, dt_count);
+          }
+
+          if(m_status_interval.count() > 0
+              && time_start - m_last_status_time >= m_status_interval)
+          {
+            m_last_status_time = time_start;
+            add_queue_status(out_messages);
+          }
+          m_jwt_server.send_messages(std::move(out_messages));
+
+          // issue every game token at once, signing them in parallel
+          m_jwt_server.complete_sessions(games);
+          games.clear();
+
+          if(m_queue_log.is_open()) {
+            update_queue_log();
           }
         }
       }
     }
 
   private:
+    static matchmaker make_matchmaker(const std::string& key) {
+      if constexpr(std::is_constructible_v<matchmaker, const std::string&>) {
+        return matchmaker(key);
+      } else {
+        return matchmaker();
+      }
+    }
+
+    static bool can_match(match_queue& queue) {
+      if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+        return queue.mm.can_match();
+      } else {
+        return queue.mm.can_match(queue.sessions);
+      }
+    }
+
+    static void match(match_queue& queue, long dt) {
+      if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+        queue.mm.match(queue.games, queue.messages, dt);
+      } else {
+        queue.mm.match(queue.games, queue.messages, queue.sessions, dt);
+      }
+    }
+
+    bool can_match() {
+      return std::any_of(
+          m_queue_list.begin(),
+          m_queue_list.end(),
+          [](match_queue* queue) { return can_match(*queue); }
+        );
+    }
+
+    // returns whether any session is queued or awaiting restoration
+    bool has_sessions() const {
+      return !m_restored_sessions.empty() || std::any_of(
+          m_queue_list.begin(),
+          m_queue_list.end(),
+          [](const match_queue* queue) { return !queue->sessions.empty(); }
+        );
+    }
+
+    void match(long dt) {
+      if(m_queue_list.size() == 1) {
+        match(*m_queue_list.front(), dt);
+        return;
+      }
+
+      // queues are completely independent, so match them in parallel
+      std::for_each(
+          std::execution::par,
+          m_queue_list.begin(),
+          m_queue_list.end(),
+          [dt](match_queue* queue) { match(*queue, dt); }
+        );
+    }
+
+    // returns the queue with the given key, creating it if necessary
+    match_queue& get_queue(const std::string& key) {
+      auto it = m_queues.find(key);
+      if(it == m_queues.end()) {
+        spdlog::debug("creating matchmaking queue '{}'", key);
+        it = m_queues.try_emplace(key, key).first;
+        m_queue_list.push_back(&it->second);
+      }
+      return it->second;
+    }
+
+    // adds a session to its queue's matchmaker
+    static void join_queue(
+        match_queue& queue,
+        const session_id& sid,
+        session_data&& data,
+        long waited
+      )
+    {
+      auto data_it = queue.sessions.emplace(sid, std::move(data)).first;
+      if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+        if constexpr(accepts_join_wait_time<matchmaker>::value) {
+          queue.mm.on_join(data_it->first, data_it->second, waited);
+        } else {
+          queue.mm.on_join(data_it->first, data_it->second);
+        }
+      }
+    }
+
+    void erase_session(const session_id& sid) {
+      auto queue_it = m_session_queues.find(sid);
+      if(queue_it != m_session_queues.end()) {
+        leave_order(sid);
+        queue_it->second.queue->sessions.erase(sid);
+        m_session_queues.erase(queue_it);
+      }
+      m_session_players.erase(sid);
+    }
+
+    // removes a session from its queue's join order as soon as it is matched
+    // or cancelled, while its data is kept for another time-step
+    void leave_order(const session_id& sid) {
+      auto queue_it = m_session_queues.find(sid);
+      if(queue_it != m_session_queues.end()) {
+        queue_entry& entry = queue_it->second;
+        if(entry.order_it != entry.queue->order.end()) {
+          entry.queue->order.erase(entry.order_it);
+          entry.order_it = entry.queue->order.end();
+          if(m_queue_log.is_open()) {
+            m_queue_log.leave(sid);
+          }
+        }
+      }
+    }
+
+    // cancels restored sessions none of whose players reconnected in time
+    void cancel_restored_sessions() {
+      std::size_t cancel_count = 0;
+      for(const session_id& sid : m_restored_sessions) {
+        auto it = m_session_queues.find(sid);
+        if(it != m_session_queues.end() && it->second.is_restored) {
+          m_jwt_server.complete_session(
+              sid,
+              sid,
+              it->second.queue->mm.get_cancel_data()
+            );
+          leave_order(sid);
+          m_session_queues.erase(it);
+          ++cancel_count;
+        }
+      }
+      m_restored_sessions.clear();
+      spdlog::info(
+          "cancelled {} restored sessions without players", cancel_count
+        );
+    }
+
+    // the queued sessions of every queue in the order they joined
+    vector<typename session_log::entry> queued_entries() {
+      vector<typename session_log::entry> entries;
+      for(match_queue* queue : m_queue_list) {
+        for(const session_id& sid : queue->order) {
+          entries.push_back(typename session_log::entry{
+              sid,
+              queue->key,
+              m_session_queues.at(sid).join_time
+            });
+        }
+      }
+      return entries;
+    }
+
+    // writes out the time-step's log records, rewriting the log if too long
+    void update_queue_log(bool compact = false) {
+      try {
+        if(compact || m_queue_log.needs_compaction(m_session_queues.size())) {
+          m_queue_log.compact(queued_entries());
+        } else {
+          m_queue_log.flush();
+        }
+      } catch(typename session_log::log_error& e) {
+        spdlog::error("closing queue log: {}", e.what());
+        m_queue_log.close();
+      }
+    }
+
+    // exponential moving average with a time constant of a minute
+    static void update_match_rate(
+        match_queue& queue,
+        std::size_t matched_count,
+        long dt
+      )
+    {
+      if(dt <= 0) {
+        return;
+      }
+      const double rate = 1000.0 * matched_count / dt;
+      const double alpha = 1.0 - std::exp(-dt / 60000.0);
+      queue.match_rate += alpha * (rate - queue.match_rate);
+    }
+
+    // appends a status message for every session whose position changed
+    void add_queue_status(vector<pair<combined_id, std::string> >& messages) {
+      for(match_queue* queue : m_queue_list) {
+        queue_status status{ 0, queue->order.size(), std::nullopt };
+        for(const session_id& sid : queue->order) {
+          ++status.position;
+
+          if(queue->match_rate > 0) {
+            status.estimated_wait = std::chrono::milliseconds{
+              static_cast<long>(1000.0 * status.position / queue->match_rate)
+            };
+          }
+
+          queue_entry& entry = m_session_queues.at(sid);
+          if(entry.last_position == status.position
+              && !estimate_changed(entry.last_estimate, status.estimated_wait))
+          {
+            continue;
+          }
+          entry.last_position = status.position;
+          entry.last_estimate = status.estimated_wait;
+
+          auto players_it = m_session_players.find(sid);
+          if(players_it != m_session_players.end()) {
+            std::string msg = m_format_status(status);
+            for(const player_id& pid : players_it->second) {
+              messages.emplace_back(combined_id{ pid, sid }, msg);
+            }
+          }
+        }
+      }
+    }
+
+    static bool estimate_changed(
+        const std::optional<std::chrono::milliseconds>& last,
+        const std::optional<std::chrono::milliseconds>& current
+      )
+    {
+      if(!last || !current) {
+        return last.has_value() != current.has_value();
+      }
+      return 5 * std::abs(current->count() - last->count()) > last->count();
+    }
+
+    static std::string format_queue_status(const queue_status& status) {
+      json msg;
+      msg["type"] = "queue_status";
+      msg["position"] = status.position;
+      msg["queue_size"] = status.queue_size;
+      if(status.estimated_wait) {
+        msg["estimated_wait"] = status.estimated_wait->count();
+      } else {
+        msg["estimated_wait"] = nullptr;
+      }
+      return msg.dump();
+    }
+
+    // cancels every queued session, used once a draining server can no
+    // longer match the sessions left in its queues
+    void cancel_sessions() {
+      for(match_queue* queue : m_queue_list) {
+        for(auto& session_pair : queue->sessions) {
+          spdlog::trace("cancelling session {}", session_pair.first);
+          m_jwt_server.complete_session(
+              session_pair.first,
+              session_pair.first,
+              queue->mm.get_cancel_data()
+            );
+          if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+            queue->mm.on_leave(session_pair.first);
+          }
+        }
+        queue->sessions.clear();
+        queue->order.clear();
+      }
+      for(const session_id& sid : m_restored_sessions) {
+        auto it = m_session_queues.find(sid);
+        if(it != m_session_queues.end() && it->second.is_restored) {
+          m_jwt_server.complete_session(
+              sid,
+              sid,
+              it->second.queue->mm.get_cancel_data()
+            );
+        }
+      }
+      m_session_queues.clear();
+      m_session_players.clear();
+      m_restored_sessions.clear();
+      if(m_queue_log.is_open()) {
+        update_queue_log(true);
+      }
+    }
+
+    // cancels a session that could not be added to a queue, without
+    // creating a queue for it
+    void reject_session(const session_id& sid) {
+      auto queue_it = m_queues.find(std::string{});
+      m_jwt_server.complete_session(
+          sid,
+          sid,
+          queue_it != m_queues.end()
+            ? queue_it->second.mm.get_cancel_data()
+            : make_matchmaker(std::string{}).get_cancel_data()
+        );
+    }
+
     vector<session_id> process_connection_updates() {
       vector<connection_update> connection_updates;
       {
@@ -265,45 +868,80 @@ namespace simple_web_game_server {
 
       vector<session_id> finished_sessions;
       for(connection_update& update : connection_updates) {
-        auto it = m_session_data.find(update.id.session);
+        auto it = m_session_queues.find(update.id.session);
         if(update.disconnection) {
-          if(it != m_session_data.end()) {
+          if(it != m_session_queues.end()) {
             spdlog::trace(
                 "processiong disconnection for session {}", update.id.session
               );
+            match_queue& queue = *it->second.queue;
             m_jwt_server.complete_session(
                 update.id.session,
                 update.id.session,
-                m_matchmaker.get_cancel_data()
+                queue.mm.get_cancel_data()
               );
-            m_session_data.erase(it);
+            leave_order(update.id.session);
+            queue.sessions.erase(update.id.session);
+            m_session_queues.erase(it);
             m_session_players.erase(update.id.session);
+            if constexpr(is_incremental_matchmaker<matchmaker>::value) {
+              queue.mm.on_leave(update.id.session);
+            }
             finished_sessions.push_back(update.id.session);
           }
         } else {
           spdlog::trace(
               "processiong connection for session {}", update.id.session
             );
-          if(it == m_session_data.end()) {
+          if(it == m_session_queues.end()) {
+            std::string key;
+            try {
+              key = m_get_queue_key(update.data);
+            } catch(std::exception& e) {
+              spdlog::debug(
+                  "no queue key for session {}: {}", update.id.session, e.what()
+                );
+              reject_session(update.id.session);
+              finished_sessions.push_back(update.id.session);
+              continue;
+            }
+
+            match_queue& queue = get_queue(key);
             session_data data{update.data};
 
             if(data.is_valid()) {
-              m_session_data.emplace(
-                  update.id.session, std::move(data)
+              const auto join_time = wall_clock::now();
+              join_queue(queue, update.id.session, std::move(data), 0);
+              queue.order.push_back(update.id.session);
+              m_session_queues.emplace(
+                  update.id.session,
+                  queue_entry{ &queue, std::prev(queue.order.end()), join_time }
                 );
               m_session_players.emplace(
                   update.id.session, set<player_id>{ update.id.player }
                 );
+              if(m_queue_log.is_open()) {
+                m_queue_log.join(typename session_log::entry{
+                    update.id.session, key, join_time
+                  });
+              }
             } else {
               m_jwt_server.complete_session(
                   update.id.session,
                   update.id.session,
-                  m_matchmaker.get_cancel_data()
+                  queue.mm.get_cancel_data()
                 );
               finished_sessions.push_back(update.id.session);
             }
+          } else if(it->second.is_restored) {
+            restore_session(it, update);
+            if(m_session_queues.count(update.id.session) == 0) {
+              finished_sessions.push_back(update.id.session);
+            }
           } else {
             m_session_players.at(update.id.session).insert(update.id.player);
+            // make sure the new player is sent the session's status
+            it->second.last_position = 0;
           }
         }
       }
@@ -311,6 +949,45 @@ namespace simple_web_game_server {
       return finished_sessions;
     }
 
+    // hands a restored session to its matchmaker once a player reconnects,
+    // keeping its place in the queue and the time it has already waited
+    void restore_session(
+        typename unordered_map<session_id, queue_entry, id_hash>::iterator it,
+        const connection_update& update
+      )
+    {
+      match_queue& queue = *it->second.queue;
+      session_data data{update.data};
+      if(!data.is_valid()) {
+        m_jwt_server.complete_session(
+            update.id.session,
+            update.id.session,
+            queue.mm.get_cancel_data()
+          );
+        leave_order(update.id.session);
+        m_session_queues.erase(it);
+        return;
+      }
+
+      const long waited = std::max(
+          0L,
+          static_cast<long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+              wall_clock::now() - it->second.join_time
+            ).count()
+          )
+        );
+      spdlog::trace(
+          "restoring session {} after {}ms", update.id.session, waited
+        );
+
+      it->second.is_restored = false;
+      join_queue(queue, update.id.session, std::move(data), waited);
+      m_session_players.emplace(
+          update.id.session, set<player_id>{ update.id.player }
+        );
+    }
+
     // proper procedure for client to cancel matchmaking is to send a message
     // and wait for the server to close the connection; by acquiring the match
     // lock and marking the user as unavailable we avoid the situation where a
@@ -343,10 +1020,18 @@ namespace simple_web_game_server {
     }
 
     // member variables
-    matchmaker m_matchmaker;
-
-    unordered_map<session_id, session_data, id_hash> m_session_data;
+    // m_match_lock guards the members from m_queues to m_restore_deadline
+    unordered_map<std::string, match_queue> m_queues;
+    vector<match_queue*> m_queue_list;
+    unordered_map<session_id, queue_entry, id_hash> m_session_queues;
     unordered_map<session_id, set<player_id>, id_hash> m_session_players;
+    function<std::string(const json&)> m_get_queue_key;
+    std::chrono::milliseconds m_status_interval;
+    function<std::string(const queue_status&)> m_format_status;
+    typename clock::time_point m_last_status_time;
+    session_log m_queue_log;
+    vector<session_id> m_restored_sessions;
+    typename clock::time_point m_restore_deadline;
     mutex m_match_lock;
 
     std::vector<connection_update> m_connection_updates;
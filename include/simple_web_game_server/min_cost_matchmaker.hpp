@@ -0,0 +1,464 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_MIN_COST_MATCHMAKER_HPP
+#define JWT_GAME_SERVER_MIN_COST_MATCHMAKER_HPP
+
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <tuple>
+#include <string>
+#include <utility>
+#include <iterator>
+#include <exception>
+
+namespace simple_web_game_server {
+  /// A struct defining the default match cost for min_cost_matchmaker.
+  /**
+   * The cost of pairing two sessions is
+   *
+   *     rating_weight() * |rating difference|
+   *       + region_penalty() if the regions differ
+   *       - wait_weight() * (seconds waited by both sessions)
+   *
+   * and a pair is only made if its cost is below unmatched_cost().
+   */
+  struct default_matching_traits {
+    /// The cost of one point of rating difference.
+    static constexpr double rating_weight() {
+      return 1.0;
+    }
+    /// The cost of pairing sessions from different regions.
+    static constexpr double region_penalty() {
+      return 100.0;
+    }
+    /// The cost removed per second waited by each session of a pair.
+    static constexpr double wait_weight() {
+      return 10.0;
+    }
+    /// The cost of leaving a session unmatched for another tick.
+    static constexpr double unmatched_cost() {
+      return 100.0;
+    }
+    /// The number of rating neighbours considered as partners per session.
+    static constexpr std::size_t candidate_count() {
+      return 8;
+    }
+    /// The maximum number of longest waiting sessions matched per tick.
+    static constexpr std::size_t pool_size() {
+      return 2000;
+    }
+    /// The auction bid increment, bounding the error per session.
+    static constexpr double epsilon() {
+      return 1.0;
+    }
+    /// Reads a session's rating from its login data.
+    template<typename json>
+    static double get_rating(const json& data) {
+      return data.at("rating").template get<double>();
+    }
+    /// Reads a session's latency region from its login data.
+    template<typename json>
+    static std::string get_region(const json& data) {
+      return data.value("region", std::string{});
+    }
+  };
+
+  /// An incremental matchmaker pairing sessions by a global min-cost match.
+  /**
+   * Once per tick the longest waiting sessions, up to
+   * matching_traits::pool_size(), are paired to minimize the total cost
+   * defined by matching_traits, see default_matching_traits. Each session
+   * may be paired with its matching_traits::candidate_count() nearest
+   * neighbours by rating or left unmatched.
+   *
+   * The matching is solved as a symmetric assignment problem by a sparse
+   * forward auction over a pool copied into contiguous storage, so that a
+   * tick costs O(pool_size() * candidate_count()) for the typical handful
+   * of bids per session. Cycles of the resulting
+   * assignment are split into pairs, taking the cheaper alternating set of
+   * edges. The assignment found is within epsilon() per session of the
+   * optimal assignment over the candidate edges.
+   *
+   * Unlike an incremental auction, prices are not kept warm between ticks;
+   * each solve starts from zero prices. The pool is rebuilt and reordered by
+   * rating every tick, so there is no stable object to carry a price, and
+   * the prices of sessions left unmatched only grow, so carrying them per
+   * session provokes long bidding wars with the sessions that replace those
+   * matched, costing more than the cold start it would save.
+   *
+   * A session's wait starts at the first call to match() after it joins,
+   * once that call's delta_time has passed, so time the queue spent idle
+   * before it joined is never credited to it.
+   *
+   * Matched games are given the data {"matched": true}. Game session ids are
+   * constructed from an unsigned long counter shared by all instances.
+   */
+  template<typename player_traits_type, typename json,
+    typename matching_traits = default_matching_traits>
+  class min_cost_matchmaker {
+  public:
+    using player_traits = player_traits_type;
+    using session_id = typename player_traits::id::session_id;
+    using id_hash = typename player_traits::id::hash;
+    using message = std::pair<session_id, std::string>;
+    using game = std::tuple<std::vector<session_id>, session_id, json>;
+
+    /// The rating and region stored for each queued session.
+    struct session_data {
+      session_data(const json& data) : rating(0), valid(true) {
+        try {
+          rating = matching_traits::get_rating(data);
+          region = matching_traits::get_region(data);
+        } catch(std::exception& e) {
+          valid = false;
+        }
+      }
+
+      bool is_valid() {
+        return valid;
+      }
+
+      double rating;
+      std::string region;
+      bool valid;
+    };
+
+    min_cost_matchmaker() : m_time(0) {}
+
+    bool can_match() const {
+      // joining sessions need a call to match() to start waiting
+      return !m_joined.empty() || m_sessions.size() > 1;
+    }
+
+    /// Adds a session that has already waited the given milliseconds.
+    void on_join(
+        const session_id& sid,
+        const session_data& data,
+        long waited = 0
+      )
+    {
+      if(m_sessions.count(sid) > 0) {
+        return;
+      }
+
+      // the join time is set by the next match(), see start_waiting()
+      auto region_it = m_regions.emplace(data.region, m_regions.size()).first;
+      m_sessions.emplace(
+          sid,
+          m_joined.insert(
+            m_joined.end(),
+            queued_session{ sid, data.rating, region_it->second, -waited, true }
+          )
+        );
+    }
+
+    void on_leave(const session_id& sid) {
+      auto it = m_sessions.find(sid);
+      if(it != m_sessions.end()) {
+        if(it->second->joining) {
+          m_joined.erase(it->second);
+        } else {
+          m_queue.erase(it->second);
+        }
+        m_sessions.erase(it);
+      }
+    }
+
+    void match(
+        std::vector<game>& game_list,
+        std::vector<message>& messages,
+        long delta_time
+      )
+    {
+      m_time += delta_time;
+      start_waiting();
+      if(m_sessions.size() < 2) {
+        return;
+      }
+
+      auto start = std::chrono::steady_clock::now();
+
+      build_pool();
+      solve();
+
+      for(const std::pair<std::size_t, std::size_t>& p : extract_pairs()) {
+        queue_iterator first = m_pool[p.first].session;
+        queue_iterator second = m_pool[p.second].session;
+
+        game_list.emplace_back(
+            std::vector<session_id>{ first->sid, second->sid },
+            next_game_id(),
+            json{ { "matched", true } }
+          );
+
+        m_sessions.erase(first->sid);
+        m_sessions.erase(second->sid);
+        m_queue.erase(first);
+        m_queue.erase(second);
+      }
+
+      m_solve_times.record(std::chrono::steady_clock::now() - start);
+    }
+
+    json get_cancel_data() const {
+      json temp;
+      temp["matched"] = false;
+      return temp;
+    }
+
+    /// Returns the number of queued sessions.
+    std::size_t size() const {
+      return m_sessions.size();
+    }
+
+    /// Returns the histogram of time taken to solve each tick's matching.
+    const latency_histogram& get_solve_time_histogram() const {
+      return m_solve_times;
+    }
+
+  private:
+    struct queued_session {
+      session_id sid;
+      double rating;
+      std::size_t region;
+      // minus the time already waited while the session is joining
+      long join_time;
+      bool joining;
+    };
+
+    using session_list = std::list<queued_session>;
+    using queue_iterator = typename session_list::iterator;
+
+    struct pool_entry {
+      double rating;
+      std::size_t region;
+      long join_time;
+      queue_iterator session;
+    };
+
+    static session_id next_game_id() {
+      static std::atomic<unsigned long> sid_count{ 0 };
+      return static_cast<session_id>(sid_count++);
+    }
+
+    // gives the sessions that joined since the last match() their join time,
+    // moving them into the queue which is kept ordered by join time
+    void start_waiting() {
+      while(!m_joined.empty()) {
+        queue_iterator it = m_joined.begin();
+        it->join_time += m_time;
+        it->joining = false;
+
+        auto position = m_queue.end();
+        while(position != m_queue.begin()
+            && std::prev(position)->join_time > it->join_time)
+        {
+          --position;
+        }
+        // splicing keeps the iterator stored in m_sessions valid
+        m_queue.splice(position, m_joined, it);
+      }
+    }
+
+    // the pool is the longest waiting sessions ordered by rating
+    void build_pool() {
+      m_pool.clear();
+      for(auto it = m_queue.begin(); it != m_queue.end()
+          && m_pool.size() < matching_traits::pool_size(); ++it)
+      {
+        m_pool.push_back(pool_entry{ it->rating, it->region, it->join_time, it });
+      }
+
+      std::sort(
+          m_pool.begin(),
+          m_pool.end(),
+          [](const pool_entry& a, const pool_entry& b) {
+            return a.rating < b.rating;
+          }
+        );
+    }
+
+    // the value to session i of being assigned object j, where assigning a
+    // session to itself leaves it unmatched
+    double benefit(std::size_t i, std::size_t j) const {
+      if(i == j) {
+        return -matching_traits::unmatched_cost();
+      }
+      return -pair_cost(i, j);
+    }
+
+    double pair_cost(std::size_t i, std::size_t j) const {
+      const pool_entry& a = m_pool[i];
+      const pool_entry& b = m_pool[j];
+
+      double cost = matching_traits::rating_weight()
+        * std::abs(a.rating - b.rating);
+      if(a.region != b.region) {
+        cost += matching_traits::region_penalty();
+      }
+      cost -= matching_traits::wait_weight()
+        * static_cast<double>(2 * m_time - a.join_time - b.join_time) / 1000.0;
+
+      return cost;
+    }
+
+    // the candidate objects of session i are its rating neighbours, a
+    // window of pool indices which always contains i itself
+    std::pair<std::size_t, std::size_t> candidates(std::size_t i) const {
+      const std::size_t n = m_pool.size();
+      const std::size_t half = matching_traits::candidate_count() / 2;
+      std::size_t first = i > half ? i - half : 0;
+      std::size_t last = std::min(n, first + 2 * half + 1);
+      first = last > 2 * half + 1 ? last - 2 * half - 1 : 0;
+      return { first, last };
+    }
+
+    // sparse forward auction from zero prices, see the class description
+    void solve() {
+      const std::size_t n = m_pool.size();
+      const std::size_t none = n;
+      constexpr double lowest = std::numeric_limits<double>::lowest();
+
+      m_prices.assign(n, 0);
+
+      m_owners.assign(n, none);
+      m_assigned.assign(n, none);
+      m_unassigned.clear();
+      for(std::size_t i = n; i > 0; --i) {
+        m_unassigned.push_back(i - 1);
+      }
+
+      while(!m_unassigned.empty()) {
+        const std::size_t i = m_unassigned.back();
+        m_unassigned.pop_back();
+
+        std::size_t best = none;
+        double best_value = lowest;
+        double second_value = lowest;
+
+        auto [first, last] = candidates(i);
+        for(std::size_t j = first; j < last; ++j) {
+          const double value = benefit(i, j) - m_prices[j];
+          if(value > best_value) {
+            second_value = best_value;
+            best_value = value;
+            best = j;
+          } else if(value > second_value) {
+            second_value = value;
+          }
+        }
+
+        double increment = matching_traits::epsilon();
+        if(second_value != lowest) {
+          increment += best_value - second_value;
+        }
+        m_prices[best] += increment;
+
+        if(m_owners[best] != none) {
+          m_assigned[m_owners[best]] = none;
+          m_unassigned.push_back(m_owners[best]);
+        }
+        m_owners[best] = i;
+        m_assigned[i] = best;
+      }
+    }
+
+    // splits each cycle of the assignment into pairs, taking the cheaper of
+    // its two alternating edge sets and dropping pairs not worth making
+    std::vector<std::pair<std::size_t, std::size_t> > extract_pairs() {
+      const std::size_t n = m_pool.size();
+      std::vector<std::pair<std::size_t, std::size_t> > pairs;
+      std::vector<bool> visited(n, false);
+      std::vector<std::size_t> cycle;
+
+      for(std::size_t start = 0; start < n; ++start) {
+        if(visited[start]) {
+          continue;
+        }
+
+        cycle.clear();
+        for(std::size_t i = start; !visited[i]; i = m_assigned[i]) {
+          visited[i] = true;
+          cycle.push_back(i);
+        }
+        if(cycle.size() < 2) {
+          continue;
+        }
+
+        // a cycle of length l has l / 2 disjoint pairs starting at either
+        // of its first two sessions
+        const std::size_t length = cycle.size();
+        auto offset_cost = [&](std::size_t offset) {
+          double cost = 0;
+          for(std::size_t k = 0; k + 1 < length; k += 2) {
+            cost += std::min(
+                pair_cost(
+                  cycle[(k + offset) % length],
+                  cycle[(k + offset + 1) % length]
+                ),
+                matching_traits::unmatched_cost()
+              );
+          }
+          return cost;
+        };
+        const std::size_t offset =
+          (length > 2 && offset_cost(1) < offset_cost(0)) ? 1 : 0;
+
+        for(std::size_t k = 0; k + 1 < length; k += 2) {
+          const std::size_t a = cycle[(k + offset) % length];
+          const std::size_t b = cycle[(k + offset + 1) % length];
+          if(pair_cost(a, b) < matching_traits::unmatched_cost()) {
+            pairs.emplace_back(a, b);
+          }
+        }
+      }
+
+      return pairs;
+    }
+
+    session_list m_queue;
+    session_list m_joined;
+    std::unordered_map<session_id, queue_iterator, id_hash> m_sessions;
+    std::unordered_map<std::string, std::size_t> m_regions;
+
+    // scratch space reused by each tick's solve
+    std::vector<pool_entry> m_pool;
+    std::vector<double> m_prices;
+    std::vector<std::size_t> m_owners;
+    std::vector<std::size_t> m_assigned;
+    std::vector<std::size_t> m_unassigned;
+
+    latency_histogram m_solve_times;
+    long m_time;
+  };
+}
+
+#endif // JWT_GAME_SERVER_MIN_COST_MATCHMAKER_HPP
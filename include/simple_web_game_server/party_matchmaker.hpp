@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_PARTY_MATCHMAKER_HPP
+#define JWT_GAME_SERVER_PARTY_MATCHMAKER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <tuple>
+#include <string>
+#include <utility>
+#include <iterator>
+#include <exception>
+
+namespace simple_web_game_server {
+  /// A struct defining the default team layout for party_matchmaker.
+  struct default_party_traits {
+    /// The number of players on each team.
+    static constexpr std::size_t team_size() {
+      return 4;
+    }
+    /// The number of teams in each game.
+    static constexpr std::size_t team_count() {
+      return 2;
+    }
+    /// Reads the number of players in a session's party from its login data.
+    template<typename json>
+    static std::size_t get_party_size(const json& data) {
+      return data.value("party_size", 1);
+    }
+  };
+
+  /// An incremental matchmaker packing parties into fixed size teams.
+  /**
+   * Each session is a party of one or more players that must be placed on
+   * the same team, see is_incremental_matchmaker. Parties are kept in a FIFO
+   * list per party size, so the queue itself is never scanned. A game is
+   * always built around the longest waiting party: the teams are filled one
+   * at a time by a bounded subset-sum search over the number of queued
+   * parties of each size, preferring larger parties, and the parties of each
+   * chosen size are taken oldest first. Building a game therefore costs
+   * O(team_size^2 * team_count) regardless of the length of the queue.
+   *
+   * Matched games are given the data
+   *
+   *     { "matched": true, "teams": [ [ sid, ... ], ... ] }
+   *
+   * listing the party sessions on each team, so session ids must be
+   * convertible to json. Game session ids are constructed from an unsigned
+   * long counter shared by all instances.
+   */
+  template<typename player_traits_type, typename json,
+    typename party_traits = default_party_traits>
+  class party_matchmaker {
+  public:
+    using player_traits = player_traits_type;
+    using session_id = typename player_traits::id::session_id;
+    using id_hash = typename player_traits::id::hash;
+    using message = std::pair<session_id, std::string>;
+    using game = std::tuple<std::vector<session_id>, session_id, json>;
+
+    /// The party data stored for each queued session.
+    struct session_data {
+      session_data(const json& data) : party_size(0) {
+        try {
+          party_size = party_traits::get_party_size(data);
+        } catch(std::exception& e) {
+          party_size = 0;
+        }
+      }
+
+      bool is_valid() {
+        return party_size > 0 && party_size <= party_traits::team_size();
+      }
+
+      std::size_t party_size;
+    };
+
+    party_matchmaker() : m_queues(party_traits::team_size() + 1),
+      m_player_count(0), m_seq_count(0), m_is_blocked(false) {}
+
+    /// Returns whether a game might be formed from the queued parties.
+    /**
+     * Returns false after a call to match() failed to form a game, until a
+     * party joins or leaves.
+     */
+    bool can_match() const {
+      return !m_is_blocked && m_player_count >= game_size();
+    }
+
+    void on_join(const session_id& sid, const session_data& data) {
+      if(m_parties.count(sid) > 0) {
+        return;
+      }
+
+      party_list& queue = m_queues[data.party_size];
+      queue.push_back(queued_party{ sid, m_seq_count++ });
+      m_parties.emplace(
+          sid,
+          queue_position{ data.party_size, std::prev(queue.end()) }
+        );
+      m_player_count += data.party_size;
+      m_is_blocked = false;
+    }
+
+    void on_leave(const session_id& sid) {
+      auto it = m_parties.find(sid);
+      if(it == m_parties.end()) {
+        return;
+      }
+
+      m_queues[it->second.size].erase(it->second.position);
+      m_player_count -= it->second.size;
+      m_parties.erase(it);
+      m_is_blocked = false;
+    }
+
+    void match(
+        std::vector<game>& game_list,
+        std::vector<message>& messages,
+        long delta_time
+      )
+    {
+      while(m_player_count >= game_size()) {
+        std::optional<std::vector<std::vector<std::size_t> > > teams;
+
+        // first try to place the longest waiting party, then any parties
+        const std::size_t oldest_size = oldest_party_size();
+        teams = find_teams(oldest_size);
+        if(!teams) {
+          teams = find_teams(0);
+        }
+        if(!teams) {
+          m_is_blocked = true;
+          return;
+        }
+
+        std::vector<session_id> sessions;
+        json team_list = json::array();
+        for(const std::vector<std::size_t>& team : *teams) {
+          json team_json = json::array();
+          for(std::size_t size : team) {
+            const session_id sid = pop_party(size);
+            team_json.push_back(sid);
+            sessions.push_back(sid);
+          }
+          team_list.push_back(std::move(team_json));
+        }
+
+        json game_data;
+        game_data["matched"] = true;
+        game_data["teams"] = std::move(team_list);
+
+        game_list.emplace_back(
+            std::move(sessions),
+            next_game_id(),
+            std::move(game_data)
+          );
+      }
+    }
+
+    json get_cancel_data() const {
+      json temp;
+      temp["matched"] = false;
+      return temp;
+    }
+
+    /// Returns the number of queued parties.
+    std::size_t size() const {
+      return m_parties.size();
+    }
+
+  private:
+    struct queued_party {
+      session_id sid;
+      unsigned long seq;
+    };
+
+    using party_list = std::list<queued_party>;
+    using party_iterator = typename party_list::iterator;
+
+    struct queue_position {
+      std::size_t size;
+      party_iterator position;
+    };
+
+    static constexpr std::size_t game_size() {
+      return party_traits::team_size() * party_traits::team_count();
+    }
+
+    static session_id next_game_id() {
+      static std::atomic<unsigned long> sid_count{ 0 };
+      return static_cast<session_id>(sid_count++);
+    }
+
+    std::size_t oldest_party_size() const {
+      std::size_t oldest_size = 0;
+      for(std::size_t size = 1; size < m_queues.size(); ++size) {
+        const party_list& queue = m_queues[size];
+        if(!queue.empty() && (oldest_size == 0
+              || queue.front().seq < m_queues[oldest_size].front().seq))
+        {
+          oldest_size = size;
+        }
+      }
+      return oldest_size;
+    }
+
+    session_id pop_party(std::size_t size) {
+      party_list& queue = m_queues[size];
+      const session_id sid = queue.front().sid;
+      queue.pop_front();
+      m_parties.erase(sid);
+      m_player_count -= size;
+      return sid;
+    }
+
+    // chooses the party sizes on each team, requiring a party of the given
+    // size on the first team if it is non-zero
+    std::optional<std::vector<std::vector<std::size_t> > > find_teams(
+        std::size_t required_size
+      ) const
+    {
+      std::vector<std::size_t> counts(m_queues.size(), 0);
+      for(std::size_t size = 1; size < m_queues.size(); ++size) {
+        counts[size] = m_queues[size].size();
+      }
+
+      std::vector<std::vector<std::size_t> > teams;
+      for(std::size_t t = 0; t < party_traits::team_count(); ++t) {
+        std::vector<std::size_t> team;
+        std::size_t remaining = party_traits::team_size();
+        if(t == 0 && required_size > 0) {
+          --counts[required_size];
+          team.push_back(required_size);
+          remaining -= required_size;
+        }
+
+        if(!fill_team(counts, remaining, team)) {
+          return std::nullopt;
+        }
+        teams.push_back(std::move(team));
+      }
+
+      return teams;
+    }
+
+    // bounded subset-sum over party sizes: reachable[s][r] records whether a
+    // sum of r players may be formed from parties of size at most s
+    static bool fill_team(
+        std::vector<std::size_t>& counts,
+        std::size_t target,
+        std::vector<std::size_t>& team
+      )
+    {
+      const std::size_t max_size = counts.size() - 1;
+      std::vector<std::vector<bool> > reachable(
+          max_size + 1,
+          std::vector<bool>(target + 1, false)
+        );
+      reachable[0][0] = true;
+
+      for(std::size_t size = 1; size <= max_size; ++size) {
+        for(std::size_t sum = 0; sum <= target; ++sum) {
+          for(std::size_t k = 0; k <= counts[size] && k * size <= sum; ++k) {
+            if(reachable[size - 1][sum - k * size]) {
+              reachable[size][sum] = true;
+              break;
+            }
+          }
+        }
+      }
+
+      if(!reachable[max_size][target]) {
+        return false;
+      }
+
+      // walk back from the largest size, taking as many as possible
+      std::size_t sum = target;
+      for(std::size_t size = max_size; size > 0; --size) {
+        std::size_t k = std::min(counts[size], sum / size);
+        while(!reachable[size - 1][sum - k * size]) {
+          --k;
+        }
+        for(std::size_t i = 0; i < k; ++i) {
+          team.push_back(size);
+        }
+        counts[size] -= k;
+        sum -= k * size;
+      }
+
+      return true;
+    }
+
+    std::vector<party_list> m_queues;
+    std::unordered_map<session_id, queue_position, id_hash> m_parties;
+
+    std::size_t m_player_count;
+    unsigned long m_seq_count;
+    bool m_is_blocked;
+  };
+}
+
+#endif // JWT_GAME_SERVER_PARTY_MATCHMAKER_HPP
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_QUEUE_LOG_HPP
+#define JWT_GAME_SERVER_QUEUE_LOG_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace simple_web_game_server {
+  /// An append-only log of the sessions waiting in matchmaking queues.
+  /**
+   * Each line of the log is a JSON record of a session joining a queue
+   *
+   *     { "op": "join", "sid": sid, "key": "queue key", "time": ms }
+   *
+   * where time is the wall clock time the session first joined, in
+   * milliseconds since the epoch, or of a session leaving its queue
+   *
+   *     { "op": "leave", "sid": sid }
+   *
+   * Records are buffered and written by flush(), so a crash loses at most
+   * the records since the last flush; a partially written last line is
+   * ignored by load(). Once the log holds more than twice as many records as
+   * there are queued sessions it should be rewritten by compact(), which
+   * writes a snapshot of the queued sessions to a temporary file and renames
+   * it over the log, so the log is always either the old or the new one and
+   * its length stays proportional to the queue.
+   *
+   * Session ids must be convertible to and from json, and the json type must
+   * provide the nlohmann::json interface.
+   */
+  template<typename session_id, typename json,
+    typename id_hash = std::hash<session_id> >
+  class queue_log {
+  public:
+    /// The class representing errors reading or writing the log.
+    class log_error : public std::runtime_error {
+    public:
+      using super = std::runtime_error;
+      explicit log_error(const std::string& what_arg) noexcept :
+        super(what_arg) {}
+      explicit log_error(const char* what_arg) noexcept : super(what_arg) {}
+    };
+
+    /// The wall clock time a session joined its queue.
+    using time_point = std::chrono::system_clock::time_point;
+
+    /// A queued session recorded in the log.
+    struct entry {
+      session_id sid;
+      std::string key;
+      time_point join_time;
+    };
+
+    queue_log() : m_record_count(0) {}
+
+    /// Replays the log at the given path.
+    /**
+     * Returns the sessions that joined and did not leave, in the order they
+     * first joined. A missing file is an empty log.
+     */
+    static std::vector<entry> load(const std::string& path) {
+      std::ifstream file(path);
+      if(!file) {
+        return {};
+      }
+
+      std::list<entry> queued;
+      std::unordered_map<
+          session_id,
+          typename std::list<entry>::iterator,
+          id_hash
+        > positions;
+
+      std::string line;
+      while(std::getline(file, line)) {
+        json record = json::parse(line, nullptr, false);
+        if(record.is_discarded() || !record.is_object()) {
+          // only the last line may be torn by a crash
+          break;
+        }
+
+        try {
+          const session_id sid = record.at("sid").template get<session_id>();
+          const std::string op = record.at("op").template get<std::string>();
+          if(op == "join") {
+            if(positions.count(sid) == 0) {
+              queued.push_back(entry{
+                  sid,
+                  record.at("key").template get<std::string>(),
+                  time_point{ std::chrono::milliseconds{
+                    record.at("time").template get<long long>()
+                  } }
+                });
+              positions.emplace(sid, std::prev(queued.end()));
+            }
+          } else if(op == "leave") {
+            auto it = positions.find(sid);
+            if(it != positions.end()) {
+              queued.erase(it->second);
+              positions.erase(it);
+            }
+          }
+        } catch(std::exception& e) {
+          break;
+        }
+      }
+
+      return { queued.begin(), queued.end() };
+    }
+
+    /// Starts a new log at the given path holding the given sessions.
+    void open(const std::string& path, const std::vector<entry>& queued) {
+      close();
+      m_path = path;
+      compact(queued);
+    }
+
+    /// Returns whether the log has been opened.
+    bool is_open() const {
+      return m_file.is_open();
+    }
+
+    /// Flushes and closes the log, leaving it on disk.
+    void close() {
+      if(m_file.is_open()) {
+        m_file << m_buffer;
+        m_buffer.clear();
+        m_file.close();
+      }
+    }
+
+    /// Records that a session joined a queue.
+    void join(const entry& e) {
+      append(join_record(e));
+    }
+
+    /// Records that a session left its queue.
+    void leave(const session_id& sid) {
+      json record;
+      record["op"] = "leave";
+      record["sid"] = sid;
+      append(record);
+    }
+
+    /// Writes out all buffered records.
+    void flush() {
+      if(m_buffer.empty()) {
+        return;
+      }
+      m_file << m_buffer;
+      m_file.flush();
+      m_buffer.clear();
+      if(!m_file) {
+        throw log_error{"failed to write queue log " + m_path};
+      }
+    }
+
+    /// Returns whether the log should be compacted.
+    bool needs_compaction(std::size_t queued_count) const {
+      return m_record_count > 2 * queued_count + min_compaction_size;
+    }
+
+    /// Replaces the log with a snapshot of the given queued sessions.
+    void compact(const std::vector<entry>& queued) {
+      const std::string temp_path = m_path + ".tmp";
+      m_buffer.clear();
+      m_record_count = 0;
+      if(m_file.is_open()) {
+        m_file.close();
+      }
+
+      {
+        std::ofstream temp(temp_path, std::ios::trunc);
+        for(const entry& e : queued) {
+          temp << join_record(e).dump() << '\n';
+        }
+        temp.flush();
+        if(!temp) {
+          throw log_error{"failed to write queue log " + temp_path};
+        }
+      }
+
+      if(std::rename(temp_path.c_str(), m_path.c_str()) != 0) {
+        throw log_error{"failed to replace queue log " + m_path};
+      }
+
+      m_file.open(m_path, std::ios::app);
+      if(!m_file) {
+        throw log_error{"failed to open queue log " + m_path};
+      }
+      m_record_count = queued.size();
+    }
+
+  private:
+    // small logs are not worth rewriting
+    static constexpr std::size_t min_compaction_size = 1024;
+
+    static json join_record(const entry& e) {
+      json record;
+      record["op"] = "join";
+      record["sid"] = e.sid;
+      record["key"] = e.key;
+      record["time"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+          e.join_time.time_since_epoch()
+        ).count();
+      return record;
+    }
+
+    void append(const json& record) {
+      m_buffer += record.dump();
+      m_buffer += '\n';
+      ++m_record_count;
+    }
+
+    std::string m_path;
+    std::ofstream m_file;
+    std::string m_buffer;
+    std::size_t m_record_count;
+  };
+}
+
+#endif // JWT_GAME_SERVER_QUEUE_LOG_HPP
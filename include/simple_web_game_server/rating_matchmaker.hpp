@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JWT_GAME_SERVER_RATING_MATCHMAKER_HPP
+#define JWT_GAME_SERVER_RATING_MATCHMAKER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <queue>
+#include <tuple>
+#include <string>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <exception>
+
+namespace simple_web_game_server {
+  /// A struct defining the default rating window for rating_matchmaker.
+  struct default_rating_traits {
+    /// The rating difference accepted for a session that just joined.
+    static constexpr double initial_window() {
+      return 50.0;
+    }
+    /// The increase in accepted rating difference per second of waiting.
+    static constexpr double window_growth() {
+      return 25.0;
+    }
+    /// The largest rating difference that will ever be accepted.
+    static constexpr double max_window() {
+      return 400.0;
+    }
+    /// Reads a session's rating from its login data.
+    template<typename json>
+    static double get_rating(const json& data) {
+      return data.at("rating").template get<double>();
+    }
+  };
+
+  /// An incremental matchmaker pairing sessions of similar rating.
+  /**
+   * Sessions are indexed by rating, see is_incremental_matchmaker. Two
+   * sessions may be paired once their rating difference is within the window
+   * of the longer waiting of the two, where the window starts at
+   * rating_traits::initial_window() and grows by
+   * rating_traits::window_growth() per second of waiting up to
+   * rating_traits::max_window().
+   *
+   * Only sessions adjacent in rating order can be each other's closest
+   * match, so the matchmaker keeps a min-heap of the time at which each
+   * adjacent pair becomes acceptable. A join, leave, or match changes O(1)
+   * adjacent pairs, and a call to match() only visits pairs that have become
+   * acceptable, so each costs O(log n) in the number of queued sessions.
+   *
+   * A session's wait starts at the first call to match() after it joins,
+   * once that call's delta_time has passed, so time the queue spent idle
+   * before it joined is never credited to it.
+   *
+   * Matched games are given the data {"matched": true}. Game session ids are
+   * constructed from an unsigned long counter shared by all instances, so
+   * ids stay unique when a matchmaking_server runs several queues.
+   */
+  template<typename player_traits_type, typename json,
+    typename rating_traits = default_rating_traits>
+  class rating_matchmaker {
+  public:
+    using player_traits = player_traits_type;
+    using session_id = typename player_traits::id::session_id;
+    using id_hash = typename player_traits::id::hash;
+    using message = std::pair<session_id, std::string>;
+    using game = std::tuple<std::vector<session_id>, session_id, json>;
+
+    /// The rating data stored for each queued session.
+    struct session_data {
+      session_data(const json& data) : rating(0), valid(true) {
+        try {
+          rating = rating_traits::get_rating(data);
+        } catch(std::exception& e) {
+          valid = false;
+        }
+      }
+
+      bool is_valid() {
+        return valid;
+      }
+
+      double rating;
+      bool valid;
+    };
+
+    rating_matchmaker() : m_time(0), m_seq_count(0) {}
+
+    /// Returns whether there is any pair of sessions that may be matched.
+    bool can_match() const {
+      // joining sessions need a call to match() to start waiting
+      return !m_joined.empty() || (m_sessions.size() > 1 && !m_pairs.empty());
+    }
+
+    /// Adds a session that has already waited the given milliseconds.
+    void on_join(
+        const session_id& sid,
+        const session_data& data,
+        long waited = 0
+      )
+    {
+      if(m_sessions.count(sid) > 0) {
+        return;
+      }
+
+      // the join time is set by the next match(), see start_waiting()
+      rating_key key{ data.rating, m_seq_count++ };
+      m_ratings.emplace(key, queued_session{ sid, -waited, true });
+      m_sessions.emplace(sid, key);
+      m_joined.push_back(key);
+    }
+
+    void on_leave(const session_id& sid) {
+      auto session_it = m_sessions.find(sid);
+      if(session_it != m_sessions.end()) {
+        erase(m_ratings.find(session_it->second));
+      }
+    }
+
+    void match(
+        std::vector<game>& game_list,
+        std::vector<message>& messages,
+        long delta_time
+      )
+    {
+      m_time += delta_time;
+      start_waiting();
+
+      while(!m_pairs.empty() && m_pairs.top().ready_time <= m_time) {
+        rating_pair p = m_pairs.top();
+        m_pairs.pop();
+
+        // pairs are invalidated lazily, so check both are still adjacent
+        auto left_it = m_ratings.find(p.left);
+        if(left_it == m_ratings.end()) {
+          continue;
+        }
+        auto right_it = std::next(left_it);
+        if(right_it == m_ratings.end() || right_it->first != p.right) {
+          continue;
+        }
+
+        game_list.emplace_back(
+            std::vector<session_id>{ left_it->second.sid, right_it->second.sid },
+            next_game_id(),
+            json{ { "matched", true } }
+          );
+
+        erase(left_it);
+        erase(right_it);
+      }
+    }
+
+    json get_cancel_data() const {
+      json temp;
+      temp["matched"] = false;
+      return temp;
+    }
+
+    /// Returns the number of queued sessions.
+    std::size_t size() const {
+      return m_sessions.size();
+    }
+
+  private:
+    // ratings are made unique by the order sessions joined
+    using rating_key = std::pair<double, unsigned long>;
+
+    struct queued_session {
+      session_id sid;
+      // minus the time already waited while the session is joining
+      long join_time;
+      bool joining;
+    };
+
+    using rating_map = std::map<rating_key, queued_session>;
+    using rating_iterator = typename rating_map::iterator;
+
+    struct rating_pair {
+      long ready_time;
+      rating_key left;
+      rating_key right;
+
+      bool operator>(const rating_pair& other) const {
+        return ready_time > other.ready_time;
+      }
+    };
+
+    static session_id next_game_id() {
+      static std::atomic<unsigned long> sid_count{ 0 };
+      return static_cast<session_id>(sid_count++);
+    }
+
+    // gives the sessions that joined since the last match() their join time
+    // and schedules their pairs with their neighbors
+    void start_waiting() {
+      for(const rating_key& key : m_joined) {
+        auto it = m_ratings.find(key);
+        if(it != m_ratings.end()) {
+          it->second.join_time += m_time;
+          it->second.joining = false;
+        }
+      }
+
+      for(const rating_key& key : m_joined) {
+        auto it = m_ratings.find(key);
+        if(it == m_ratings.end()) {
+          continue;
+        }
+        if(it != m_ratings.begin()) {
+          push_pair(std::prev(it), it);
+        }
+        if(std::next(it) != m_ratings.end()) {
+          push_pair(it, std::next(it));
+        }
+      }
+      m_joined.clear();
+    }
+
+    // removes a session, making its neighbors adjacent
+    void erase(rating_iterator it) {
+      m_sessions.erase(it->second.sid);
+
+      auto next_it = m_ratings.erase(it);
+      if(next_it != m_ratings.begin() && next_it != m_ratings.end()) {
+        push_pair(std::prev(next_it), next_it);
+      }
+    }
+
+    // schedules an adjacent pair for the time it becomes acceptable
+    void push_pair(rating_iterator left, rating_iterator right) {
+      // pairs with joining sessions are pushed once they start waiting
+      if(left->second.joining || right->second.joining) {
+        return;
+      }
+
+      const double difference = right->first.first - left->first.first;
+      if(difference > rating_traits::max_window()) {
+        return;
+      }
+
+      long wait_time = 0;
+      if(difference > rating_traits::initial_window()) {
+        wait_time = static_cast<long>(
+            1000.0 * (difference - rating_traits::initial_window())
+              / rating_traits::window_growth()
+          ) + 1;
+      }
+
+      const long first_join = std::min(
+          left->second.join_time,
+          right->second.join_time
+        );
+
+      m_pairs.push(rating_pair{
+          first_join + wait_time,
+          left->first,
+          right->first
+        });
+    }
+
+    rating_map m_ratings;
+    std::unordered_map<session_id, rating_key, id_hash> m_sessions;
+    std::priority_queue<
+        rating_pair,
+        std::vector<rating_pair>,
+        std::greater<rating_pair>
+      > m_pairs;
+    std::vector<rating_key> m_joined;
+
+    long m_time;
+    unsigned long m_seq_count;
+  };
+}
+
+#endif // JWT_GAME_SERVER_RATING_MATCHMAKER_HPP
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef WEBSOCKETPP_COMMON_SIMD_HPP
+#define WEBSOCKETPP_COMMON_SIMD_HPP
+
+// Detects the x86 vector extensions the compiler may use. Loops over payload
+// bytes use them where available and fall back to portable scalar code
+// otherwise. SSE2 is part of every x86-64 target, AVX2 is used by code built
+// with e.g. -mavx2 or -march=native and, for some loops, chosen at runtime.
+//
+// Defining _WEBSOCKETPP_NO_SIMD_ forces the scalar code.
+
+#ifndef _WEBSOCKETPP_NO_SIMD_
+    #if defined(__SSE2__) || defined(_M_X64) \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define _WEBSOCKETPP_SSE2_
+    #endif
+
+    #if defined(__AVX2__) && defined(_WEBSOCKETPP_SSE2_)
+        #define _WEBSOCKETPP_AVX2_
+    #endif
+#endif
+
+// Where AVX2 is not enabled at compile time, GCC and Clang can still compile
+// individual functions for it with the target attribute. Such functions may
+// only be called once cpu_supports_avx2() has returned true.
+#if defined(_WEBSOCKETPP_SSE2_) && !defined(_WEBSOCKETPP_AVX2_) \
+    && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define _WEBSOCKETPP_AVX2_DISPATCH_
+    #define _WEBSOCKETPP_AVX2_TARGET_ __attribute__((target("avx2")))
+#else
+    #define _WEBSOCKETPP_AVX2_TARGET_
+#endif
+
+#if defined(_WEBSOCKETPP_AVX2_) || defined(_WEBSOCKETPP_AVX2_DISPATCH_)
+    #include <immintrin.h>
+#elif defined(_WEBSOCKETPP_SSE2_)
+    #include <emmintrin.h>
+#endif
+
+namespace websocketpp {
+namespace lib {
+
+/// Returns whether AVX2 code may be run
+/**
+ * True if AVX2 is enabled at compile time, or if AVX2 functions can be
+ * selected at runtime and the CPU running the program supports them.
+ */
+inline bool cpu_supports_avx2() {
+#if defined(_WEBSOCKETPP_AVX2_)
+    return true;
+#elif defined(_WEBSOCKETPP_AVX2_DISPATCH_)
+    static bool const supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+} // namespace lib
+} // namespace websocketpp
+
+#endif // WEBSOCKETPP_COMMON_SIMD_HPP
@@ -44,6 +44,7 @@
     #include <type_traits>
 #else
     #include <boost/aligned_storage.hpp>
+    #include <boost/type_traits/integral_constant.hpp>
 #endif
 
 
@@ -54,9 +55,15 @@ namespace lib {
 #ifdef _WEBSOCKETPP_CPP11_TYPE_TRAITS_
     using std::aligned_storage;
     using std::is_same;
+    using std::integral_constant;
+    using std::true_type;
+    using std::false_type;
 #else
     using boost::aligned_storage;
     using boost::is_same;
+    using boost::integral_constant;
+    using boost::true_type;
+    using boost::false_type;
 #endif
 
 } // namespace lib
@@ -192,6 +192,45 @@ struct debug_core {
     ///
     static const size_t connection_read_buffer_size = 16384;
 
+    /// Borrow the per-connection read buffer from a pool only while reading
+    /**
+     * When true, connections do not hold their read buffer for their whole
+     * lifetime. An idle connection waits for its socket to become readable
+     * and only then borrows a buffer of connection_read_buffer_size bytes
+     * from a process wide pool, giving it back once the bytes read have been
+     * processed. This saves the buffer for every idle connection at the cost
+     * of an extra wait per read. Requires the asio transport. With TLS the
+     * wait completes immediately, as decrypted bytes may already be buffered.
+     */
+    static const bool enable_read_buffer_pool = false;
+
+    /// Maximum number of frames gathered into a single transport write
+    /**
+     * Frames queued for a connection are written together in one scatter
+     * gather write of their headers and payloads. Frames queued beyond this
+     * many are left for the next write, bounding the size of a write and the
+     * time other work on the connection waits for it.
+     */
+    static const size_t max_frames_per_write = 256;
+
+    /// Largest payload copied into a shared write buffer with its header
+    /**
+     * Headers, and payloads of at most this many bytes, are copied into one
+     * contiguous buffer per write rather than each being given a buffer of
+     * their own. Many small frames then fit in one writev call, which takes a
+     * limited number of buffers. Zero only coalesces headers.
+     */
+    static const size_t max_coalesced_payload_size = 512;
+
+    /// Largest write buffer a connection keeps between writes
+    /**
+     * The buffer small frames are coalesced into grows to fit the largest
+     * write. Once a write completes the buffer is freed if its capacity is
+     * above this many bytes, so a burst of frames doesn't leave every idle
+     * connection holding a large buffer.
+     */
+    static const size_t max_idle_coalesce_buffer_size = 16384;
+
     /// Drop connections immediately on protocol error.
     /**
      * Drop connections on protocol error rather than sending a close frame.
@@ -36,11 +36,14 @@
 #include <websocketpp/processors/processor.hpp>
 #include <websocketpp/transport/base/connection.hpp>
 #include <websocketpp/http/constants.hpp>
+#include <websocketpp/message_buffer/read_buffer.hpp>
 
 #include <websocketpp/common/connection_hdl.hpp>
 #include <websocketpp/common/cpp11.hpp>
 #include <websocketpp/common/functional.hpp>
+#include <websocketpp/common/type_traits.hpp>
 
+#include <atomic>
 #include <queue>
 #include <sstream>
 #include <string>
@@ -286,6 +289,10 @@ public:
     // Misc Convenience Types
     typedef session::internal_state::value istate_type;
 
+    /// Type of the connection read buffer, inline or borrowed from a pool
+    typedef message_buffer::read_buffer<config::connection_read_buffer_size,
+        config::enable_read_buffer_pool> read_buffer_type;
+
 private:
     enum terminate_status {
         failed = 1,
@@ -303,6 +310,12 @@ public:
             lib::placeholders::_1,
             lib::placeholders::_2
         ))
+      , m_handle_readable(lib::bind(
+            &type::handle_readable,
+            this,
+            lib::placeholders::_1,
+            lib::placeholders::_2
+        ))
       , m_write_frame_handler(lib::bind(
             &type::handle_write_frame,
             this,
@@ -317,6 +330,7 @@ public:
       , m_internal_state(session::internal_state::USER_INIT)
       , m_msg_manager(new con_msg_manager_type())
       , m_send_buffer_size(0)
+      , m_frames_written(0)
       , m_write_flag(false)
       , m_read_flag(true)
       , m_is_server(p_is_server)
@@ -330,6 +344,7 @@ public:
       , m_was_clean(false)
     {
         m_alog->write(log::alevel::devel,"connection constructor");
+        m_buf = NULL;
     }
 
     /// Get a shared pointer to this component
@@ -636,6 +651,17 @@ public:
         return get_buffered_amount();
     }
 
+    /// Get the number of frames written to the transport
+    /**
+     * Counts the frames of every completed write. Together with the number of
+     * write operations of transports that count them, e.g.
+     * get_write_op_count() of the asio transport, gives the number of frames
+     * sent per system call.
+     *
+     * @return The number of frames written on this connection.
+     */
+    size_t get_frames_written() const;
+
     ////////////////////
     // Action Methods //
     ////////////////////
@@ -1305,6 +1331,13 @@ public:
     void handle_read_frame(lib::error_code const & ec, size_t bytes_transferred);
     void read_frame();
 
+    /// Issue a read into the read buffer held for the connection's lifetime
+    void async_read_frame(lib::false_type);
+    /// Release the pooled read buffer and wait for the socket to be readable
+    void async_read_frame(lib::true_type);
+    /// Borrow a pooled read buffer and read the bytes now available
+    void handle_readable(lib::error_code const & ec, size_t bytes_transferred);
+
     /// Get array of WebSocket protocol versions that this connection supports.
     std::vector<int> const & get_supported_versions() const;
 
@@ -1491,6 +1524,7 @@ private:
 
     // internal handler functions
     read_handler            m_handle_read_frame;
+    read_handler            m_handle_readable;
     write_frame_handler     m_write_frame_handler;
 
     // static settings
@@ -1539,7 +1573,8 @@ private:
     mutex_type              m_write_lock;
 
     // connection resources
-    char                    m_buf[config::connection_read_buffer_size];
+    read_buffer_type        m_read_buffer;
+    char *                  m_buf;
     size_t                  m_buf_cursor;
     termination_handler     m_termination_handler;
     con_msg_manager_ptr     m_msg_manager;
@@ -1583,6 +1618,15 @@ private:
     /// from going out of scope before the write is complete.
     std::vector<message_ptr> m_current_msgs;
 
+    /// headers and small payloads of the current write, copied contiguously
+    /**
+     * Lock m_write_lock
+     */
+    std::string m_coalesce_buffer;
+
+    /// Number of frames written to the transport, may be read by any thread
+    std::atomic<size_t> m_frames_written;
+
     /// True if there is currently an outstanding transport write
     /**
      * Lock m_write_lock
@@ -29,8 +29,10 @@
 #define WEBSOCKETPP_FRAME_HPP
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 
+#include <websocketpp/common/simd.hpp>
 #include <websocketpp/common/system_error.hpp>
 #include <websocketpp/common/network.hpp>
 
@@ -312,6 +314,11 @@ void word_mask_exact(uint8_t * data, size_t length, masking_key_type const &
 size_t word_mask_circ(uint8_t * input, uint8_t * output, size_t length,
     size_t prepared_key);
 size_t word_mask_circ(uint8_t * data, size_t length, size_t prepared_key);
+size_t vector_mask_circ(uint8_t const * input, uint8_t * output,
+    size_t length, size_t prepared_key);
+size_t vector_mask_circ(uint8_t * data, size_t length, size_t prepared_key);
+size_t vector_mask_ascii(uint8_t const * input, uint8_t * output,
+    size_t length, size_t prepared_key);
 
 /// Check whether the frame's FIN bit is set.
 /**
@@ -858,6 +865,245 @@ inline size_t byte_mask_circ(uint8_t* data, size_t length, size_t prepared_key){
     return byte_mask_circ(data,data,length,prepared_key);
 }
 
+#ifdef _WEBSOCKETPP_SSE2_
+/// SSE2 mask/unmask of whole 16 byte blocks
+/**
+ * Masks the longest prefix of input that is a multiple of 16 bytes. input and
+ * output may be the same buffer and need not be aligned.
+ *
+ * @param key The masking key as it is laid out in memory
+ *
+ * @return The number of bytes masked
+ */
+inline size_t sse2_mask(uint8_t const * input, uint8_t * output, size_t length,
+    uint32_t key)
+{
+    __m128i k = _mm_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; length - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input+i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i),
+            _mm_xor_si128(v,k));
+    }
+    return i;
+}
+#endif
+
+#if defined(_WEBSOCKETPP_AVX2_) || defined(_WEBSOCKETPP_AVX2_DISPATCH_)
+/// AVX2 mask/unmask of whole 32 byte blocks
+/**
+ * As sse2_mask with 32 byte blocks. Must only be called if
+ * lib::cpu_supports_avx2() is true.
+ *
+ * @see sse2_mask
+ */
+_WEBSOCKETPP_AVX2_TARGET_
+inline size_t avx2_mask(uint8_t const * input, uint8_t * output, size_t length,
+    uint32_t key)
+{
+    __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; length - i >= 32; i += 32) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const *>(input+i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+i),
+            _mm256_xor_si256(v,k));
+    }
+    return i;
+}
+#endif
+
+/// Circular vectorized mask/unmask
+/**
+ * Performs a circular mask/unmask with the widest vector instructions the CPU
+ * supports, using pre-prepared keys that store state between calls, like
+ * byte_mask_circ. Unlike word_mask_circ it has no alignment or padding
+ * requirements: exactly length bytes are read and written, and input and
+ * output may be the same buffer.
+ *
+ * AVX2 is used if enabled at compile time or, with GCC and Clang, if the CPU
+ * supports it, otherwise SSE2 on x86, and otherwise word sized chunks. The
+ * remainder is masked word and byte wise.
+ *
+ * @param input Character buffer to mask
+ *
+ * @param output Character buffer to store the output
+ *
+ * @param length Length of data
+ *
+ * @param prepared_key Prepared key to use.
+ *
+ * @return the prepared_key shifted to account for the input length
+ */
+inline size_t vector_mask_circ(uint8_t const * input, uint8_t * output,
+    size_t length, size_t prepared_key)
+{
+    uint32_t key;
+    std::memcpy(&key,&prepared_key,sizeof(key));
+
+    // every block is a multiple of 4 bytes, so the key keeps its phase
+    size_t i = 0;
+#if defined(_WEBSOCKETPP_AVX2_) || defined(_WEBSOCKETPP_AVX2_DISPATCH_)
+    if (lib::cpu_supports_avx2()) {
+        i = avx2_mask(input,output,length,key);
+    }
+#endif
+#ifdef _WEBSOCKETPP_SSE2_
+    i += sse2_mask(input+i,output+i,length-i,key);
+#endif
+
+    for (; length - i >= sizeof(size_t); i += sizeof(size_t)) {
+        size_t word;
+        std::memcpy(&word,input+i,sizeof(word));
+        word ^= prepared_key;
+        std::memcpy(output+i,&word,sizeof(word));
+    }
+
+    uint8_t const * byte_key = reinterpret_cast<uint8_t const *>(&key);
+    for (; i < length; ++i) {
+        output[i] = input[i] ^ byte_key[i % 4];
+    }
+
+    return circshift_prepared_key(prepared_key,length % 4);
+}
+
+/// Circular vectorized mask/unmask (in place)
+/**
+ * In place version of vector_mask_circ
+ *
+ * @see vector_mask_circ
+ *
+ * @param data Character buffer to read from and write to
+ *
+ * @param length Length of data
+ *
+ * @param prepared_key Prepared key to use.
+ *
+ * @return the prepared_key shifted to account for the input length
+ */
+inline size_t vector_mask_circ(uint8_t * data, size_t length,
+    size_t prepared_key)
+{
+    return vector_mask_circ(data,data,length,prepared_key);
+}
+
+#ifdef _WEBSOCKETPP_SSE2_
+/// SSE2 kernel of vector_mask_ascii
+/**
+ * @see vector_mask_ascii
+ */
+inline size_t sse2_mask_ascii(uint8_t const * input, uint8_t * output,
+    size_t length, uint32_t key)
+{
+    __m128i k = _mm_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; length - i >= 64; i += 64) {
+        __m128i const * in = reinterpret_cast<__m128i const *>(input+i);
+        __m128i * out = reinterpret_cast<__m128i *>(output+i);
+        __m128i a = _mm_xor_si128(_mm_loadu_si128(in),k);
+        __m128i b = _mm_xor_si128(_mm_loadu_si128(in+1),k);
+        __m128i c = _mm_xor_si128(_mm_loadu_si128(in+2),k);
+        __m128i d = _mm_xor_si128(_mm_loadu_si128(in+3),k);
+        _mm_storeu_si128(out,a);
+        _mm_storeu_si128(out+1,b);
+        _mm_storeu_si128(out+2,c);
+        _mm_storeu_si128(out+3,d);
+        __m128i high = _mm_or_si128(_mm_or_si128(a,b),_mm_or_si128(c,d));
+        if (_mm_movemask_epi8(high) != 0) {
+            break;
+        }
+    }
+    return i;
+}
+#endif
+
+#if defined(_WEBSOCKETPP_AVX2_) || defined(_WEBSOCKETPP_AVX2_DISPATCH_)
+/// AVX2 kernel of vector_mask_ascii
+/**
+ * Must only be called if lib::cpu_supports_avx2() is true.
+ *
+ * @see vector_mask_ascii
+ */
+_WEBSOCKETPP_AVX2_TARGET_
+inline size_t avx2_mask_ascii(uint8_t const * input, uint8_t * output,
+    size_t length, uint32_t key)
+{
+    __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; length - i >= 64; i += 64) {
+        __m256i const * in = reinterpret_cast<__m256i const *>(input+i);
+        __m256i * out = reinterpret_cast<__m256i *>(output+i);
+        __m256i a = _mm256_xor_si256(_mm256_loadu_si256(in),k);
+        __m256i b = _mm256_xor_si256(_mm256_loadu_si256(in+1),k);
+        _mm256_storeu_si256(out,a);
+        _mm256_storeu_si256(out+1,b);
+        if (_mm256_movemask_epi8(_mm256_or_si256(a,b)) != 0) {
+            break;
+        }
+    }
+    return i;
+}
+#endif
+
+/// Vectorized mask/unmask of 64 byte blocks while they are ASCII
+/**
+ * Masks input into output 64 bytes at a time, checking each masked block for
+ * bytes outside of ASCII while it is still in registers, and stops after the
+ * first block that has any. Lets a receiver unmask, copy, and UTF8 validate a
+ * mostly ASCII payload in one sweep, handing only the blocks that are not
+ * ASCII to a full validator. input and output must not overlap unless they
+ * are the same buffer.
+ *
+ * Returns the number of bytes in the leading run of ASCII blocks, a multiple
+ * of 64. If at least 64 bytes of input remain after them, the block following
+ * them, which has bytes outside of ASCII, has been masked into output too.
+ * Bytes in a trailing partial block are not masked.
+ *
+ * As the count is a multiple of 4 the prepared key needs no shifting after a
+ * call.
+ *
+ * @param input Character buffer to mask
+ *
+ * @param output Character buffer to store the output
+ *
+ * @param length Length of data
+ *
+ * @param prepared_key Prepared key to use.
+ *
+ * @return The number of leading bytes masked that were all ASCII
+ */
+inline size_t vector_mask_ascii(uint8_t const * input, uint8_t * output,
+    size_t length, size_t prepared_key)
+{
+    uint32_t key;
+    std::memcpy(&key,&prepared_key,sizeof(key));
+
+#if defined(_WEBSOCKETPP_AVX2_) || defined(_WEBSOCKETPP_AVX2_DISPATCH_)
+    if (lib::cpu_supports_avx2()) {
+        return avx2_mask_ascii(input,output,length,key);
+    }
+#endif
+#ifdef _WEBSOCKETPP_SSE2_
+    return sse2_mask_ascii(input,output,length,key);
+#else
+    size_t i = 0;
+    for (; length - i >= 64; i += 64) {
+        size_t high = 0;
+        for (size_t j = 0; j < 64; j += sizeof(size_t)) {
+            size_t word;
+            std::memcpy(&word,input+i+j,sizeof(word));
+            word ^= prepared_key;
+            std::memcpy(output+i+j,&word,sizeof(word));
+            high |= word;
+        }
+        if ((high & (~size_t(0) / 0xff * 0x80)) != 0) {
+            break;
+        }
+    }
+    return i;
+#endif
+}
+
 } // namespace frame
 } // namespace websocketpp
 
@@ -73,6 +73,11 @@ size_t connection<config>::get_buffered_amount() const {
     return m_send_buffer_size;
 }
 
+template <typename config>
+size_t connection<config>::get_frames_written() const {
+    return m_frames_written;
+}
+
 template <typename config>
 session::state::value connection<config>::get_state() const {
     //scoped_lock_type lock(m_connection_state_lock);
@@ -758,6 +763,7 @@ void connection<config>::handle_transport_init(lib::error_code const & ec) {
     }
 
     // At this point the transport is ready to read and write bytes.
+    m_buf = m_read_buffer.acquire();
     if (m_is_server) {
         m_internal_state = istate::READ_HTTP_REQUEST;
         this->read_handshake(1);
@@ -1111,7 +1117,13 @@ void connection<config>::read_frame() {
     if (!m_read_flag) {
         return;
     }
-    
+
+    this->async_read_frame(lib::integral_constant<bool,
+        config::enable_read_buffer_pool>());
+}
+
+template <typename config>
+void connection<config>::async_read_frame(lib::false_type) {
     transport_con_type::async_read_at_least(
         // std::min wont work with undefined static const values.
         // TODO: is there a more elegant way to do this?
@@ -1127,6 +1139,34 @@ void connection<config>::read_frame() {
     );
 }
 
+template <typename config>
+void connection<config>::async_read_frame(lib::true_type) {
+    // Every byte read so far has been consumed by the processor, so the
+    // buffer may be given back until the peer sends more.
+    m_read_buffer.release();
+    m_buf = NULL;
+
+    transport_con_type::async_wait_readable(m_handle_readable);
+}
+
+template <typename config>
+void connection<config>::handle_readable(lib::error_code const & ec,
+    size_t)
+{
+    if (ec) {
+        this->handle_read_frame(ec, 0);
+        return;
+    }
+
+    m_buf = m_read_buffer.acquire();
+    transport_con_type::async_read_at_least(
+        1,
+        m_buf,
+        config::connection_read_buffer_size,
+        m_handle_read_frame
+    );
+}
+
 template <typename config>
 lib::error_code connection<config>::initialize_processor() {
     m_alog->write(log::alevel::devel,"initialize_processor");
@@ -1804,12 +1844,15 @@ void connection<config>::write_frame() {
             return;
         }
 
-        // pull off all the messages that are ready to write.
-        // stop if we get a message marked terminal
+        // pull off the messages that are ready to write, up to
+        // max_frames_per_write of them. stop if we get a message marked
+        // terminal
         message_ptr next_message = write_pop();
         while (next_message) {
             m_current_msgs.push_back(next_message);
-            if (!next_message->get_terminal()) {
+            if (!next_message->get_terminal()
+                && m_current_msgs.size() < config::max_frames_per_write)
+            {
                 next_message = write_pop();
             } else {
                 next_message = message_ptr();
@@ -1827,13 +1870,48 @@ void connection<config>::write_frame() {
         }
     }
 
+    // Headers and small payloads are copied into m_coalesce_buffer, so that
+    // runs of small frames take a single buffer of the write. It is sized
+    // up front as buffers point into it.
+    size_t const max_coalesced = config::max_coalesced_payload_size;
+    size_t coalesced_size = 0;
+
     typename std::vector<message_ptr>::iterator it;
+    for (it = m_current_msgs.begin(); it != m_current_msgs.end(); ++it) {
+        coalesced_size += (*it)->get_header().size();
+        if ((*it)->get_payload().size() <= max_coalesced) {
+            coalesced_size += (*it)->get_payload().size();
+        }
+    }
+
+    m_coalesce_buffer.clear();
+    m_coalesce_buffer.reserve(coalesced_size);
+
+    size_t run_start = 0;
     for (it = m_current_msgs.begin(); it != m_current_msgs.end(); ++it) {
         std::string const & header = (*it)->get_header();
         std::string const & payload = (*it)->get_payload();
 
-        m_send_buffer.push_back(transport::buffer(header.c_str(),header.size()));
-        m_send_buffer.push_back(transport::buffer(payload.c_str(),payload.size()));   
+        m_coalesce_buffer.append(header);
+        if (payload.size() <= max_coalesced) {
+            m_coalesce_buffer.append(payload);
+            continue;
+        }
+
+        // end the run of coalesced bytes before a large payload
+        m_send_buffer.push_back(transport::buffer(
+            m_coalesce_buffer.data() + run_start,
+            m_coalesce_buffer.size() - run_start
+        ));
+        m_send_buffer.push_back(transport::buffer(payload.c_str(),payload.size()));
+        run_start = m_coalesce_buffer.size();
+    }
+
+    if (m_coalesce_buffer.size() > run_start) {
+        m_send_buffer.push_back(transport::buffer(
+            m_coalesce_buffer.data() + run_start,
+            m_coalesce_buffer.size() - run_start
+        ));
     }
 
     // Print detailed send stats if those log levels are enabled
@@ -1894,8 +1972,19 @@ void connection<config>::handle_write_frame(lib::error_code const & ec)
 
     bool terminal = m_current_msgs.back()->get_terminal();
 
+    if (!ec) {
+        m_frames_written += m_current_msgs.size();
+    }
+
     m_send_buffer.clear();
     m_current_msgs.clear();
+
+    // keep the coalesce buffer for the next write, unless a burst of frames
+    // grew it beyond what an idle connection should hold on to
+    if (m_coalesce_buffer.capacity() > config::max_idle_coalesce_buffer_size)
+    {
+        std::string().swap(m_coalesce_buffer);
+    }
     // TODO: recycle instead of deleting
 
     if (ec) {
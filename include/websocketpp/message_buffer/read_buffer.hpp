@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2020 Daniel Aven Bross
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBSOCKETPP_MESSAGE_BUFFER_READ_BUFFER_HPP
+#define WEBSOCKETPP_MESSAGE_BUFFER_READ_BUFFER_HPP
+
+#include <websocketpp/common/thread.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace websocketpp {
+namespace message_buffer {
+
+/// A process wide pool of connection read buffers of a single size
+/**
+ * Buffers are allocated on demand and returned buffers are kept for reuse,
+ * up to max_idle of them, so the memory held by the pool follows the number
+ * of reads in flight rather than the number of connections.
+ */
+template <size_t size>
+class read_buffer_pool {
+public:
+    /// The most returned buffers kept for reuse
+    static const size_t max_idle = 64;
+
+    /// Returns the pool for buffers of this size
+    static read_buffer_pool & get() {
+        static read_buffer_pool pool;
+        return pool;
+    }
+
+    ~read_buffer_pool() {
+        for (char * buf : m_idle) {
+            delete[] buf;
+        }
+    }
+
+    /// Borrows a buffer of size bytes
+    char * acquire() {
+        {
+            lib::lock_guard<lib::mutex> guard(m_lock);
+            if (!m_idle.empty()) {
+                char * buf = m_idle.back();
+                m_idle.pop_back();
+                return buf;
+            }
+        }
+        return new char[size];
+    }
+
+    /// Returns a buffer obtained from acquire()
+    void release(char * buf) {
+        {
+            lib::lock_guard<lib::mutex> guard(m_lock);
+            if (m_idle.size() < max_idle) {
+                m_idle.push_back(buf);
+                return;
+            }
+        }
+        delete[] buf;
+    }
+
+    /// Returns the number of buffers kept for reuse
+    size_t get_idle_count() {
+        lib::lock_guard<lib::mutex> guard(m_lock);
+        return m_idle.size();
+    }
+
+private:
+    read_buffer_pool() {
+        m_idle.reserve(max_idle);
+    }
+
+    read_buffer_pool(read_buffer_pool const &);
+    read_buffer_pool & operator=(read_buffer_pool const &);
+
+    lib::mutex m_lock;
+    std::vector<char *> m_idle;
+};
+
+/// The read buffer of a single connection
+/**
+ * By default the buffer is stored inline and lives as long as the connection.
+ * If pooled is true it is borrowed from the read_buffer_pool for its size by
+ * acquire() and given back by release(), so an idle connection holds none.
+ */
+template <size_t size, bool pooled>
+class read_buffer {
+public:
+    read_buffer() {}
+
+    /// Returns the buffer, borrowing it from the pool if needed
+    char * acquire() {
+        return m_buf;
+    }
+
+    /// Gives the buffer back to the pool if it is borrowed
+    void release() {}
+
+    /// Returns whether the connection currently holds a buffer
+    bool is_held() const {
+        return true;
+    }
+private:
+    read_buffer(read_buffer const &);
+    read_buffer & operator=(read_buffer const &);
+
+    char m_buf[size];
+};
+
+template <size_t size>
+class read_buffer<size, true> {
+public:
+    read_buffer() : m_buf(NULL) {}
+
+    ~read_buffer() {
+        release();
+    }
+
+    char * acquire() {
+        if (!m_buf) {
+            m_buf = read_buffer_pool<size>::get().acquire();
+        }
+        return m_buf;
+    }
+
+    void release() {
+        if (m_buf) {
+            read_buffer_pool<size>::get().release(m_buf);
+            m_buf = NULL;
+        }
+    }
+
+    bool is_held() const {
+        return m_buf != NULL;
+    }
+private:
+    read_buffer(read_buffer const &);
+    read_buffer & operator=(read_buffer const &);
+
+    char * m_buf;
+};
+
+} // namespace message_buffer
+} // namespace websocketpp
+
+#endif // WEBSOCKETPP_MESSAGE_BUFFER_READ_BUFFER_HPP
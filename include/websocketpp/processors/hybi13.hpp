@@ -49,6 +49,90 @@
 namespace websocketpp {
 namespace processor {
 
+/// Unmask and UTF8 validate up to 2048 payload bytes into output
+/**
+ * Blocks of the payload that are all ASCII are validated while still in
+ * registers. Spans around other blocks are run through the validator right
+ * after being written, while in the L1 cache. The prepared key is left in
+ * the phase of the start of the input.
+ *
+ * @see unmask_validate_append
+ */
+inline bool unmask_validate_chunk(uint8_t const * input, uint8_t * output,
+    size_t length, size_t prepared_key, utf8_validator::validator * validator)
+{
+    if (!validator) {
+        frame::vector_mask_circ(input,output,length,prepared_key);
+        return true;
+    }
+
+    // spans are multiples of 64 bytes, so the key keeps its phase
+    size_t i = 0;
+    while (length - i >= 64) {
+        size_t masked = 0;
+        if (validator->complete()) {
+            // skips the ASCII blocks, the block after them is masked too
+            i += frame::vector_mask_ascii(input+i,output+i,length-i,
+                prepared_key);
+            if (length - i < 64) {
+                break;
+            }
+            masked = 64;
+        }
+
+        // text that is not ASCII tends to come in runs, so the rest of the
+        // chunk is masked and then validated while in the L1 cache
+        size_t span = (length - i) / 64 * 64;
+        frame::vector_mask_circ(input+i+masked,output+i+masked,span-masked,
+            prepared_key);
+        if (!validator->decode(output+i,output+i+span)) {
+            return false;
+        }
+        i += span;
+    }
+
+    frame::vector_mask_circ(input+i,output+i,length-i,prepared_key);
+    return validator->decode(output+i,output+length);
+}
+
+/// Unmask, UTF8 validate, and append payload bytes in a single sweep
+/**
+ * Each input byte is read once and unmasked in registers into a small
+ * buffer on the stack, where it is validated while in the L1 cache, and
+ * then appended to the message payload. The payload is grown by appending
+ * rather than resized and overwritten, so its memory is written only once.
+ *
+ * @param [in] input The payload bytes as received
+ * @param [in] length The number of bytes in input
+ * @param [in,out] prepared_key The prepared masking key, zero if the payload
+ * is not masked, shifted to account for the input length
+ * @param [in,out] validator The UTF8 validator of a text message, or NULL if
+ * the payload is not text
+ * @param [out] out The message payload to append to
+ * @return Whether the bytes were valid UTF8. On failure some unspecified
+ * bytes will have been appended to out.
+ */
+inline bool unmask_validate_append(uint8_t const * input, size_t length,
+    size_t & prepared_key, utf8_validator::validator * validator,
+    std::string & out)
+{
+    out.reserve(out.size() + length);
+
+    // a multiple of 64 bytes, so the key keeps its phase between chunks
+    uint8_t chunk[2048];
+
+    for (size_t i = 0; i < length; i += sizeof(chunk)) {
+        size_t n = (std::min)(length - i, sizeof(chunk));
+        if (!unmask_validate_chunk(input+i,chunk,n,prepared_key,validator)) {
+            return false;
+        }
+        out.append(reinterpret_cast<char const *>(chunk),n);
+    }
+
+    prepared_key = frame::circshift_prepared_key(prepared_key,length % 4);
+    return true;
+}
+
 /// Processor for Hybi version 13 (RFC6455)
 template <typename config>
 class hybi13 : public processor<config> {
@@ -787,6 +871,8 @@ protected:
     /**
      * This function performs unmasking and uncompression, validates the
      * decoded bytes, and writes them to the appropriate message buffer.
+     * Uncompressed payloads are handled in a single sweep by
+     * unmask_validate_append.
      *
      * This member function will use the input buffer as stratch space for its
      * work. The raw input bytes will not be preserved. This applies only to the
@@ -798,33 +884,51 @@ protected:
      */
     size_t process_payload_bytes(uint8_t * buf, size_t len, lib::error_code& ec)
     {
+        std::string & out = m_current_msg->msg_ptr->get_raw_payload();
+
+        // without compression, unmask, validate, and copy in one sweep
+        if (!m_permessage_deflate.is_enabled()
+            || !m_current_msg->msg_ptr->get_compressed())
+        {
+            bool masked = frame::get_masked(m_basic_header);
+            size_t key = masked ? m_current_msg->prepared_key : 0;
+
+            utf8_validator::validator * validator = NULL;
+            if (m_current_msg->msg_ptr->get_opcode() == frame::opcode::TEXT) {
+                validator = &m_current_msg->validator;
+            }
+
+            if (!unmask_validate_append(buf,len,key,validator,out)) {
+                ec = make_error_code(error::invalid_utf8);
+                return 0;
+            }
+
+            if (masked) {
+                m_current_msg->prepared_key = key;
+            }
+            m_bytes_needed -= len;
+            return len;
+        }
+
         // unmask if masked
         if (frame::get_masked(m_basic_header)) {
-            m_current_msg->prepared_key = frame::byte_mask_circ(
+            m_current_msg->prepared_key = frame::vector_mask_circ(
                 buf, len, m_current_msg->prepared_key);
-            // TODO: SIMD masking
         }
 
-        std::string & out = m_current_msg->msg_ptr->get_raw_payload();
         size_t offset = out.size();
 
-        // decompress message if needed.
-        if (m_permessage_deflate.is_enabled()
-            && m_current_msg->msg_ptr->get_compressed())
-        {
-            // Decompress current buffer into the message buffer
-            ec = m_permessage_deflate.decompress(buf,len,out);
-            if (ec) {
-                return 0;
-            }
-        } else {
-            // No compression, straight copy
-            out.append(reinterpret_cast<char *>(buf),len);
+        // Decompress current buffer into the message buffer
+        ec = m_permessage_deflate.decompress(buf,len,out);
+        if (ec) {
+            return 0;
         }
 
         // validate unmasked, decompressed values
         if (m_current_msg->msg_ptr->get_opcode() == frame::opcode::TEXT) {
-            if (!m_current_msg->validator.decode(out.begin()+offset,out.end())) {
+            if (!m_current_msg->validator.decode(out.data()+offset,
+                out.data()+out.size()))
+            {
                 ec = make_error_code(error::invalid_utf8);
                 return 0;
             }
@@ -961,8 +1065,12 @@ protected:
     void masked_copy (std::string const & i, std::string & o,
         frame::masking_key_type key) const
     {
-        frame::byte_mask(i.begin(),i.end(),o.begin(),key);
-        // TODO: SIMD masking
+        frame::vector_mask_circ(
+            reinterpret_cast<uint8_t const *>(i.data()),
+            reinterpret_cast<uint8_t *>(&o[0]),
+            i.size(),
+            frame::prepare_masking_key(key)
+        );
     }
 
     /// Generic prepare control frame with opcode and payload.
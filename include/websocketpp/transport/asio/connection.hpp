@@ -46,6 +46,7 @@
 #include <websocketpp/common/functional.hpp>
 #include <websocketpp/common/connection_hdl.hpp>
 
+#include <atomic>
 #include <istream>
 #include <sstream>
 #include <string>
@@ -102,6 +103,7 @@ public:
       : m_is_server(is_server)
       , m_alog(alog)
       , m_elog(elog)
+      , m_write_op_count(0)
     {
         m_alog->write(log::alevel::devel,"asio con transport constructor");
     }
@@ -291,6 +293,18 @@ public:
         }
     }
 
+    /// Get the number of write operations made writing buffer sequences
+    /**
+     * Counts the socket write operations started by async_write of a vector
+     * of buffers, each of which is one system call on a plain socket unless
+     * it would block.
+     *
+     * @return The number of write operations made by this connection.
+     */
+    size_t get_write_op_count() const {
+        return m_write_op_count;
+    }
+
     /// Get the connection handle
     connection_hdl get_handle() const {
         return m_connection_hdl;
@@ -868,6 +882,38 @@ protected:
         
     }
 
+    /// Wait asynchronously until bytes can be read without blocking
+    /**
+     * Calls handler with zero bytes transferred once the socket is readable, or
+     * with the error that occurred. Lets a connection hold no read buffer while
+     * it waits for the peer.
+     */
+    void async_wait_readable(read_handler handler) {
+        if (config::enable_multithreading) {
+            socket_con_type::async_wait_readable(
+                m_strand->wrap(make_custom_alloc_handler(
+                    m_read_handler_allocator,
+                    lib::bind(
+                        &type::handle_async_read, get_shared(),
+                        handler,
+                        lib::placeholders::_1, size_t(0)
+                    )
+                ))
+            );
+        } else {
+            socket_con_type::async_wait_readable(
+                make_custom_alloc_handler(
+                    m_read_handler_allocator,
+                    lib::bind(
+                        &type::handle_async_read, get_shared(),
+                        handler,
+                        lib::placeholders::_1, size_t(0)
+                    )
+                )
+            );
+        }
+    }
+
     void handle_async_read(read_handler handler, lib::asio::error_code const & ec,
         size_t bytes_transferred)
     {
@@ -936,6 +982,13 @@ protected:
     }
 
     /// Initiate a potentially asyncronous write of the given buffers
+    /**
+     * Writes the buffers with as few write operations as the socket allows,
+     * e.g. a single writev call when the socket has room for all of them and
+     * there are few enough buffers, and counts the operations.
+     *
+     * @see get_write_op_count
+     */
     void async_write(std::vector<buffer> const & bufs, write_handler handler) {
         std::vector<buffer>::const_iterator it;
 
@@ -943,27 +996,30 @@ protected:
             m_bufs.push_back(lib::asio::buffer((*it).buf,(*it).len));
         }
 
+        async_write_some_bufs(handler);
+    }
+
+    /// Start a write operation of the remaining buffers in m_bufs
+    void async_write_some_bufs(write_handler handler) {
         if (config::enable_multithreading) {
-            lib::asio::async_write(
-                socket_con_type::get_socket(),
+            socket_con_type::get_socket().async_write_some(
                 m_bufs,
                 m_strand->wrap(make_custom_alloc_handler(
                     m_write_handler_allocator,
                     lib::bind(
-                        &type::handle_async_write, get_shared(),
+                        &type::handle_async_write_some, get_shared(),
                         handler,
                         lib::placeholders::_1, lib::placeholders::_2
                     )
                 ))
             );
         } else {
-            lib::asio::async_write(
-                socket_con_type::get_socket(),
+            socket_con_type::get_socket().async_write_some(
                 m_bufs,
                 make_custom_alloc_handler(
                     m_write_handler_allocator,
                     lib::bind(
-                        &type::handle_async_write, get_shared(),
+                        &type::handle_async_write_some, get_shared(),
                         handler,
                         lib::placeholders::_1, lib::placeholders::_2
                     )
@@ -972,6 +1028,38 @@ protected:
         }
     }
 
+    /// Write operation callback, writes any remaining buffers
+    /**
+     * @param ec The status code
+     * @param bytes_transferred The number of bytes written
+     */
+    void handle_async_write_some(write_handler handler,
+        lib::asio::error_code const & ec, size_t bytes_transferred)
+    {
+        ++m_write_op_count;
+
+        // as with asio::async_write, writing nothing without an error ends
+        // the write
+        if (!ec && bytes_transferred > 0) {
+            std::vector<lib::asio::const_buffer>::iterator it = m_bufs.begin();
+            while (it != m_bufs.end()
+                && bytes_transferred >= lib::asio::buffer_size(*it))
+            {
+                bytes_transferred -= lib::asio::buffer_size(*it);
+                ++it;
+            }
+            m_bufs.erase(m_bufs.begin(), it);
+
+            if (!m_bufs.empty()) {
+                m_bufs.front() = m_bufs.front() + bytes_transferred;
+                async_write_some_bufs(handler);
+                return;
+            }
+        }
+
+        handle_async_write(handler, ec, 0);
+    }
+
     /// Async write callback
     /**
      * @param ec The status code
@@ -1178,6 +1266,10 @@ private:
 
     std::vector<lib::asio::const_buffer> m_bufs;
 
+    /// Number of write operations made by async_write of buffer sequences,
+    /// may be read by any thread
+    std::atomic<size_t> m_write_op_count;
+
     /// Detailed internal error code
     lib::asio::error_code m_tec;
 
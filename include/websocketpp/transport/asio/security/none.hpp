@@ -125,6 +125,16 @@ public:
         return *m_socket;
     }
 
+    /// Wait asynchronously until the socket has bytes to read
+    /**
+     * This is used internally. The handler is called with an error code once
+     * a read would not block, without reading anything.
+     */
+    template <typename WaitHandler>
+    void async_wait_readable(WaitHandler handler) {
+        m_socket->async_wait(lib::asio::ip::tcp::socket::wait_read, handler);
+    }
+
     /// Get the remote endpoint address
     /**
      * The iostream transport has no information about the ultimate remote
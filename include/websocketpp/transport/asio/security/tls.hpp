@@ -120,6 +120,16 @@ public:
         return *m_socket;
     }
 
+    /// Wait asynchronously until the socket has bytes to read
+    /**
+     * This is used internally. The TLS stream may already hold decrypted bytes
+     * that the raw socket can't report, so the handler is called right away.
+     */
+    template <typename WaitHandler>
+    void async_wait_readable(WaitHandler handler) {
+        m_io_service->post(lib::bind(handler, lib::asio::error_code()));
+    }
+
     /// Set the socket initialization handler
     /**
      * The socket initialization handler is called after the socket object is
@@ -29,8 +29,11 @@
 #ifndef UTF8_VALIDATOR_HPP
 #define UTF8_VALIDATOR_HPP
 
+#include <websocketpp/common/simd.hpp>
 #include <websocketpp/common/stdint.hpp>
 
+#include <cstddef>
+#include <cstring>
 #include <string>
 
 namespace websocketpp {
@@ -77,6 +80,53 @@ inline uint32_t decode(uint32_t * state, uint32_t * codep, uint8_t byte) {
   return *state;
 }
 
+/// Returns the number of ASCII bytes at the start of a range
+/**
+ * Game and API traffic is mostly ASCII JSON, which is valid UTF8 byte for
+ * byte, so runs of it can be skipped a vector at a time rather than stepped
+ * through the decode state machine.
+ *
+ * @param begin Pointer to the start of the range
+ * @param end Pointer to the end of the range
+ * @return The length of the leading run of bytes below 0x80
+ */
+inline size_t ascii_prefix_length(uint8_t const * begin, uint8_t const * end) {
+    uint8_t const * it = begin;
+
+#ifdef _WEBSOCKETPP_AVX2_
+    for (; end - it >= 64; it += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(it));
+        __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const *>(it + 32));
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) != 0) {
+            break;
+        }
+    }
+#endif
+
+#ifdef _WEBSOCKETPP_SSE2_
+    for (; end - it >= 16; it += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+        if (_mm_movemask_epi8(v) != 0) {
+            break;
+        }
+    }
+#else
+    for (; end - it >= 8; it += 8) {
+        uint64_t word;
+        std::memcpy(&word, it, sizeof(word));
+        if ((word & 0x8080808080808080ull) != 0) {
+            break;
+        }
+    }
+#endif
+
+    while (it != end && *it < 0x80) {
+        ++it;
+    }
+    return static_cast<size_t>(it - begin);
+}
+
 /// Provides streaming UTF8 validation functionality
 class validator {
 public:
@@ -117,6 +167,38 @@ public:
         return true;
     }
 
+    /// Advance validator state with input from a contiguous range of bytes
+    /**
+     * Whenever the validator is between codepoints, runs of ASCII bytes are
+     * skipped with ascii_prefix_length rather than decoded one at a time.
+     *
+     * @param begin Pointer to the start of the input range
+     * @param end Pointer to the end of the input range
+     * @return Whether or not decoding the bytes resulted in a validation error.
+     */
+    template <typename char_type>
+    bool decode (char_type * begin, char_type * end) {
+        if (sizeof(char_type) != 1) {
+            return decode<char_type *>(begin, end);
+        }
+
+        uint8_t const * it = reinterpret_cast<uint8_t const *>(begin);
+        uint8_t const * last = reinterpret_cast<uint8_t const *>(end);
+        while (it != last) {
+            if (m_state == utf8_accept && *it < 0x80) {
+                it += ascii_prefix_length(it, last);
+                m_codepoint = *(it - 1);
+                continue;
+            }
+
+            if (utf8_validator::decode(&m_state,&m_codepoint,*it) == utf8_reject) {
+                return false;
+            }
+            ++it;
+        }
+        return true;
+    }
+
     /// Return whether the input sequence ended on a valid utf8 codepoint
     /**
      * @return Whether or not the input sequence ended on a valid codepoint.
@@ -142,7 +224,7 @@ private:
  */
 inline bool validate(std::string const & s) {
     validator v;
-    if (!v.decode(s.begin(),s.end())) {
+    if (!v.decode(s.data(),s.data()+s.size())) {
         return false;
     }
     return v.complete();
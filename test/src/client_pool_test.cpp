@@ -0,0 +1,163 @@
+#include <doctest/doctest.h>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <simple_web_game_server/client_pool.hpp>
+
+#include <websocketpp/server.hpp>
+#include <websocketpp_configs/asio_no_logs.hpp>
+#include <websocketpp_configs/asio_client_no_logs.hpp>
+
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <chrono>
+
+#include "constants.hpp"
+
+TEST_CASE("the client pool should run many connections on a few threads") {
+  using namespace std::chrono_literals;
+
+  using ws_server = websocketpp::server<asio_no_logs>;
+
+  using message_ptr = typename ws_server::message_ptr;
+  using connection_hdl = websocketpp::connection_hdl;
+
+  using test_pool = simple_web_game_server::client_pool<
+      asio_client_no_logs
+    >;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt> (oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  // an echo server recording the first message of each connection
+  std::mutex server_lock;
+  std::set<std::string> tokens;
+  std::atomic<std::size_t> server_open_count{ 0 };
+
+  ws_server server;
+  server.init_asio();
+  server.set_reuse_addr(true);
+  server.set_open_handler([&](connection_hdl) { ++server_open_count; });
+  server.set_close_handler([&](connection_hdl) { --server_open_count; });
+  server.set_message_handler(
+      [&](connection_hdl hdl, message_ptr msg) {
+        {
+          std::lock_guard<std::mutex> guard(server_lock);
+          tokens.insert(msg->get_payload());
+        }
+        server.send(hdl, msg->get_payload(), msg->get_opcode());
+      }
+    );
+
+  server.listen(SERVER_PORT);
+  server.start_accept();
+  std::thread server_thr{std::bind(&ws_server::run, &server)};
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+
+  std::this_thread::sleep_for(100ms);
+
+  constexpr std::size_t CONNECTION_COUNT = 200;
+
+  test_pool pool;
+  std::atomic<std::size_t> open_count{ 0 };
+  std::atomic<std::size_t> close_count{ 0 };
+  std::atomic<std::size_t> message_count{ 0 };
+  std::atomic<std::size_t> pong_count{ 0 };
+  std::string pong_payload;
+
+  pool.set_pong_handler(
+      [&](test_pool::connection_id id, const std::string& payload) {
+        if(id == 5) {
+          pong_payload = payload;
+        }
+        ++pong_count;
+      }
+    );
+
+  for(std::size_t i = 0; i < CONNECTION_COUNT; i++) {
+    pool.connect(
+        uri,
+        std::to_string(i),
+        [&]() { ++open_count; },
+        [&]() { ++close_count; },
+        [&](const std::string&) { ++message_count; }
+      );
+  }
+
+  std::thread pool_thr{std::bind(&test_pool::run, &pool, 2)};
+
+  for(int i = 0; i < 200 && open_count < CONNECTION_COUNT; i++) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::this_thread::sleep_for(100ms);
+
+  CHECK(pool.is_running());
+  CHECK(open_count == CONNECTION_COUNT);
+  CHECK(pool.get_open_count() == CONNECTION_COUNT);
+  CHECK(pool.get_connection_count() == CONNECTION_COUNT);
+  CHECK(server_open_count == CONNECTION_COUNT);
+  CHECK(message_count == CONNECTION_COUNT);
+  {
+    std::lock_guard<std::mutex> guard(server_lock);
+    CHECK(tokens.size() == CONNECTION_COUNT);
+  }
+
+  SUBCASE("each connection should send and close independently") {
+    pool.send(7, "hello");
+    pool.disconnect(3);
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(message_count == CONNECTION_COUNT + 1);
+    CHECK(!pool.is_open(3));
+    CHECK(pool.is_open(7));
+    CHECK(close_count == 1);
+    CHECK(pool.get_open_count() == CONNECTION_COUNT - 1);
+    CHECK_THROWS_AS(pool.send(3, "closed"), test_pool::client_error);
+  }
+
+  SUBCASE("pongs should be passed to the pong handler") {
+    pool.ping(5, "12345");
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(pong_count == 1);
+    CHECK(pong_payload == "12345");
+    CHECK_THROWS_AS(
+        pool.set_pong_handler([](test_pool::connection_id, const std::string&){}),
+        test_pool::client_error
+      );
+  }
+
+  SUBCASE("connections may be added while the pool is running") {
+    auto id = pool.connect(uri, "late");
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(id == CONNECTION_COUNT);
+    CHECK(pool.is_open(id));
+    CHECK(pool.get_open_count() == CONNECTION_COUNT + 1);
+  }
+
+  pool.stop();
+  pool_thr.join();
+
+  CHECK(!pool.is_running());
+  CHECK(pool.get_open_count() == 0);
+  CHECK(oss.str() == std::string{""});
+
+  std::this_thread::sleep_for(100ms);
+  CHECK(server_open_count == 0);
+
+  server.stop_listening();
+  server.stop();
+  server_thr.join();
+}
@@ -7,7 +7,6 @@
 #include <jwt-cpp/jwt.h>
 
 #include <simple_web_game_server/client.hpp>
-#include <model_games/minimal_game.hpp>
 
 #include <websocketpp/server.hpp>
 #include <websocketpp_configs/asio_no_logs.hpp>
@@ -58,7 +57,7 @@ TEST_CASE("the base client should interact with a websocket server") {
       messages.push_back(last_message);
     }
 
-    bool conn_open;
+    bool conn_open = false;
     connection_hdl client_hdl; 
     std::vector<std::string> messages;
     std::string last_message;
@@ -195,6 +194,210 @@ TEST_CASE("the base client should interact with a websocket server") {
     client_thr.join();
   }
 
+  SUBCASE("the client should hold sends within its send window in order") {
+    client.set_send_window(50ms);
+
+    std::thread client_thr{
+        std::bind(&ws_client::connect, &client, uri, "1234")
+      };
+
+    while(!client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    CHECK_THROWS_AS(client.set_send_window(0ms), ws_client::client_error);
+
+    for(int i = 0; i < 20; i++) {
+      std::string message = std::to_string(i);
+      CHECK(client.send(std::move(message)));
+    }
+
+    CHECK(client.get_buffered_amount() == 30);
+
+    std::this_thread::sleep_for(150ms);
+
+    CHECK(client.get_buffered_amount() == 0);
+    REQUIRE(server_data.messages.size() == 21);
+    CHECK(server_data.messages[0] == "1234");
+    for(int i = 0; i < 20; i++) {
+      CHECK(server_data.messages[i + 1] == std::to_string(i));
+    }
+
+    if(client.is_running()) {
+      client.disconnect(); 
+    }
+
+    while(client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(server_data.conn_open == false);
+    CHECK(oss.str() == std::string{""});
+    CHECK(client.has_failed() == false);
+    client_thr.join();
+  }
+
+  SUBCASE("the client should reject sends over its maximum buffered amount") {
+    client.set_send_window(1s);
+    client.set_max_buffered_amount(10);
+
+    std::thread client_thr{
+        std::bind(&ws_client::connect, &client, uri, "1234")
+      };
+
+    while(!client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(client.send("abcde"));
+    CHECK(client.send("fghij"));
+    CHECK(!client.send("k"));
+    CHECK(client.get_buffered_amount() == 10);
+
+    // disconnecting sends the messages still held in the send window
+    if(client.is_running()) {
+      client.disconnect(); 
+    }
+
+    while(client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(server_data.conn_open == false);
+    REQUIRE(server_data.messages.size() == 3);
+    CHECK(server_data.messages[1] == "abcde");
+    CHECK(server_data.last_message == "fghij");
+    CHECK(oss.str() == std::string{""});
+    CHECK(client.has_failed() == false);
+    client_thr.join();
+  }
+
+  SUBCASE("the client should reopen a dropped connection with its JWT") {
+    std::atomic<int> open_count{ 0 };
+    std::atomic<int> close_count{ 0 };
+    client.set_open_handler([&]() { ++open_count; });
+    client.set_close_handler([&]() { ++close_count; });
+    client.set_reconnect(3, 10ms, 50ms);
+
+    std::string token{"JWT"};
+    std::thread client_thr{
+        std::bind(&ws_client::connect, &client, uri, token)
+      };
+
+    while(!client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(open_count == 1);
+
+    server.close(
+        server_data.client_hdl,
+        websocketpp::close::status::going_away,
+        "restarting"
+      );
+    std::this_thread::sleep_for(200ms);
+
+    CHECK(server_data.conn_open == true);
+    CHECK(server_data.messages.size() == 2);
+    CHECK(server_data.last_message == token);
+    CHECK(client.is_running() == true);
+    CHECK(client.is_reconnecting() == false);
+    CHECK(open_count == 2);
+    CHECK(close_count == 0);
+
+    // a normal close is not reopened
+    if(client.is_running()) {
+      client.disconnect(); 
+    }
+
+    while(client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(server_data.conn_open == false);
+    CHECK(server_data.messages.size() == 2);
+    CHECK(close_count == 1);
+    CHECK(oss.str() == std::string{""});
+    CHECK(client.has_failed() == false);
+    client_thr.join();
+  }
+
+  SUBCASE("the client should give up reconnecting after its last attempt") {
+    std::atomic<int> close_count{ 0 };
+    client.set_close_handler([&]() { ++close_count; });
+    client.set_reconnect(2, 10ms, 20ms);
+
+    std::thread client_thr{
+        std::bind(&ws_client::connect, &client, uri, "1234")
+      };
+
+    while(!client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    server.stop_listening();
+    server.close(
+        server_data.client_hdl,
+        websocketpp::close::status::going_away,
+        "shutting down"
+      );
+
+    while(client.is_running()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    client_thr.join();
+
+    CHECK(close_count == 1);
+    CHECK(client.is_reconnecting() == false);
+    CHECK(server_data.messages.size() == 1);
+    CHECK(oss.str() == std::string{""});
+
+    server.listen(SERVER_PORT);
+    server.start_accept();
+  }
+
+  SUBCASE("the client should record the round trip time of its pings") {
+    client.set_ping_interval(20ms);
+
+    std::thread client_thr{
+        std::bind(&ws_client::connect, &client, uri, "1234")
+      };
+
+    while(!client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(200ms);
+
+    CHECK_THROWS_AS(client.set_ping_interval(0ms), ws_client::client_error);
+
+    const auto& rtt_times = client.get_rtt_histogram();
+    CHECK(rtt_times.count() >= 5);
+    CHECK(rtt_times.percentile(50) <= rtt_times.max());
+    CHECK(rtt_times.max() < 100ms);
+    CHECK(server_data.messages.size() == 1);
+
+    if(client.is_running()) {
+      client.disconnect(); 
+    }
+
+    while(client.is_running() && !client.has_failed()) {
+      std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(server_data.conn_open == false);
+    CHECK(oss.str() == std::string{""});
+    CHECK(client.has_failed() == false);
+    client_thr.join();
+  }
+
   SUBCASE("the client should be able to bind a function to handle open") { 
     struct test_client_data {
       void on_open() {
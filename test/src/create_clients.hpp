@@ -1,15 +1,21 @@
 #ifndef CREATE_CLIENTS_HPP
 #define CREATE_CLIENTS_HPP
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 #include <chrono>
 #include <functional>
 #include <thread>
 #include <spdlog/spdlog.h>
 
+#include <websocketpp/client.hpp>
+
 // Create player_count clients each running in a thread and using the handlers
 // provided in client_data. It is expected that clients, client_data_list, and
-// client_threads are all empty vectors which will be filled by this call.
+// client_threads are all empty containers which will be filled by this call.
+// Clients are neither copyable nor movable, so they are kept in a deque.
 // The vector of tokens is expected to contain player_count JWT token strings.
 // Clients will connect using their corresponding token to the server at the
 // provided uri. The final wait_time parameter gives the option of waiting a
@@ -17,7 +23,7 @@
 // case that it is important that your clients connect in order of creation.
 template<typename player_id, typename game_client, typename client_data>
 inline void create_clients(
-      std::vector<game_client>& clients, std::vector<client_data>& client_data_list,
+      std::deque<game_client>& clients, std::vector<client_data>& client_data_list,
       std::vector<std::thread>& client_threads,
       const std::vector<std::string>& tokens,
       const std::string& uri,
@@ -29,7 +35,7 @@ inline void create_clients(
   using std::placeholders::_2;
 
   for(std::size_t i = 0; i < player_count; i++) {
-    clients.push_back(game_client{});
+    clients.emplace_back();
     client_data_list.push_back(client_data{});
   }
 
@@ -46,11 +52,17 @@ inline void create_clients(
   }
 
   for(std::size_t i = 0; i < player_count; i++) {
+    // a client the server closes right away may finish before it is seen
+    // running
+    auto finished = std::make_shared<std::atomic<bool> >(false);
     std::thread client_thread = std::thread{
-        std::bind(&game_client::connect, &(clients[i]), uri, tokens[i])
+        [&client = clients[i], uri, token = tokens[i], finished]() {
+          client.connect(uri, token);
+          *finished = true;
+        }
       };
 
-    while(!clients[i].is_running()) {
+    while(!clients[i].is_running() && !*finished) {
       std::this_thread::sleep_for(1ms);
     }
     std::this_thread::sleep_for(std::chrono::milliseconds(wait_time));
@@ -59,4 +71,52 @@ inline void create_clients(
   }
 }
 
+// Connect a bare websocketpp client to the server at the given uri, send the
+// given token, and return the reason the server gave for closing the
+// connection. The simple_web_game_server::client does not expose the close
+// reason, so this is used to check why a client was rejected. The connection
+// is abandoned, returning an empty string, if it is still open after
+// timeout.
+template<typename client_config>
+inline std::string get_close_reason(
+      const std::string& uri,
+      const std::string& token,
+      std::chrono::milliseconds timeout = std::chrono::seconds{2}
+    ) {
+  using ws_client = websocketpp::client<client_config>;
+
+  ws_client client;
+  client.init_asio();
+  websocketpp::lib::asio::steady_timer timer{client.get_io_service(), timeout};
+
+  std::string reason;
+  client.set_open_handler([&](websocketpp::connection_hdl hdl) {
+      client.send(hdl, token, websocketpp::frame::opcode::text);
+    });
+  client.set_close_handler([&](websocketpp::connection_hdl hdl) {
+      reason = client.get_con_from_hdl(hdl)->get_remote_close_reason();
+      timer.cancel();
+    });
+  client.set_fail_handler([&](websocketpp::connection_hdl hdl) {
+      timer.cancel();
+    });
+
+  websocketpp::lib::error_code ec;
+  auto con = client.get_connection(uri, ec);
+  if(ec) {
+    spdlog::error("error creating connection: {}", ec.message());
+    return reason;
+  }
+  client.connect(con);
+
+  timer.async_wait([&](const websocketpp::lib::asio::error_code& e) {
+      if(!e) {
+        client.stop();
+      }
+    });
+  client.run();
+
+  return reason;
+}
+
 #endif // CREATE_CLIENTS_HPP
@@ -0,0 +1,89 @@
+#include <doctest/doctest.h>
+#include <nlohmann/json.hpp>
+
+#include <simple_web_game_server/delta_state.hpp>
+
+#include <vector>
+#include <string>
+
+TEST_CASE("delta_state should send snapshots and then json patches") {
+  using json = nlohmann::json;
+  using player_id = unsigned long;
+  using delta_state = simple_web_game_server::delta_state<player_id, json>;
+  using message = delta_state::message;
+
+  delta_state state;
+  std::vector<message> messages;
+
+  json board = { { "board", { 0, 0, 0 } }, { "xmove", true } };
+
+  SUBCASE("the first publish to a player should be a full snapshot") {
+    state.publish(messages, 3, board);
+
+    CHECK(messages.size() == 1);
+    CHECK(messages[0].first == 3);
+
+    json msg = json::parse(messages[0].second);
+    CHECK(msg["type"] == "state");
+    CHECK(msg["state"] == board);
+  }
+
+  SUBCASE("publishing an unchanged state should send nothing") {
+    state.publish(messages, 3, board);
+    messages.clear();
+    state.publish(messages, 3, board);
+
+    CHECK(messages.size() == 0);
+  }
+
+  SUBCASE("a patch should transform the base state into the new state") {
+    state.publish(messages, 3, board);
+    json first = json::parse(messages[0].second);
+    messages.clear();
+
+    json next = board;
+    next["board"][1] = 1;
+    next["xmove"] = false;
+    state.publish(messages, 3, next);
+
+    CHECK(messages.size() == 1);
+
+    json msg = json::parse(messages[0].second);
+    CHECK(msg["type"] == "delta");
+    CHECK(msg["base"] == first["seq"]);
+    CHECK(first["state"].patch(msg["patch"]) == next);
+  }
+
+  SUBCASE("players in sync should be sent an identical shared delta") {
+    std::vector<player_id> players{ 1, 2, 3 };
+    state.broadcast(messages, players, board);
+
+    CHECK(messages.size() == 3);
+    messages.clear();
+
+    json next = board;
+    next["board"][2] = -1;
+    state.broadcast(messages, players, next);
+
+    CHECK(messages.size() == 3);
+    CHECK(messages[0].second == messages[1].second);
+    CHECK(messages[1].second == messages[2].second);
+    CHECK(json::parse(messages[0].second)["type"] == "delta");
+  }
+
+  SUBCASE("a reset player should be sent a full snapshot") {
+    std::vector<player_id> players{ 1, 2 };
+    state.broadcast(messages, players, board);
+    messages.clear();
+
+    json next = board;
+    next["xmove"] = false;
+    state.reset(2);
+    state.broadcast(messages, players, next);
+
+    CHECK(messages.size() == 2);
+    CHECK(json::parse(messages[0].second)["type"] == "delta");
+    CHECK(json::parse(messages[1].second)["type"] == "state");
+    CHECK(json::parse(messages[1].second)["state"] == next);
+  }
+}
@@ -13,6 +13,10 @@
 #include <websocketpp_configs/asio_no_logs.hpp>
 #include <websocketpp_configs/asio_client_no_logs.hpp>
 
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <future>
 #include <thread>
 #include <functional>
 #include <sstream>
@@ -123,7 +127,7 @@ TEST_CASE("players should interact with the server with no errors") {
   game_server gs{verifier, sign_result};
   std::thread server_thr, game_thr, msg_process_thr;
   std::size_t PLAYER_COUNT;
-  std::vector<game_client> clients;
+  std::deque<game_client> clients;
   std::vector<test_client_data> client_data_list;
   std::vector<std::thread> client_threads;
   std::vector<std::string> tokens;
@@ -388,3 +392,670 @@ TEST_CASE("players should interact with the server with no errors") {
   game_thr.join();
   server_thr.join();
 }
+
+TEST_CASE("the server should record the round trip times of its players") {
+  using namespace std::chrono_literals;
+
+  using game_client = simple_web_game_server::client<
+      asio_client_no_logs
+    >;
+
+  using game_server = simple_web_game_server::game_server<
+      test_game,
+      jwt::default_clock,
+      nlohmann_traits,
+      asio_no_logs
+    >;
+
+  using combined_id = test_game::player_traits::id;
+  using player_id = combined_id::player_id;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  std::string secret = "secret";
+  std::string issuer = "jwt-gs-text";
+  jwt::verifier<jwt::default_clock, nlohmann_traits> 
+    verifier(jwt::default_clock{});
+  verifier.allow_algorithm(jwt::algorithm::hs256(secret))
+    .with_issuer(issuer);
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+
+  auto sign_result = [](combined_id id, const json& data){
+      return json{ { "pid", id.player }, { "sid", id.session } }.dump();
+    };
+
+  game_server gs{verifier, sign_result};
+  gs.set_ping_interval(20ms);
+
+  std::thread server_thr{bind(&game_server::run, &gs, SERVER_PORT, true)};
+  while(!gs.is_running()) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::thread msg_process_thr{bind(&game_server::process_messages, &gs)};
+  std::thread game_thr{bind(&game_server::update_games, &gs, 10ms)};
+
+  CHECK_THROWS(gs.set_ping_interval(0ms));
+
+  std::vector<player_id> player_list = { 5, 8 };
+  std::vector<std::string> tokens;
+  create_game_tokens(tokens, player_list, secret, issuer, 2);
+
+  game_client client_a;
+  game_client client_b;
+  std::thread client_a_thr{
+      bind(&game_client::connect, &client_a, uri, tokens[0])
+    };
+  std::thread client_b_thr{
+      bind(&game_client::connect, &client_b, uri, tokens[1])
+    };
+
+  std::this_thread::sleep_for(300ms);
+
+  CHECK(gs.get_player_count() == 2);
+  CHECK(gs.get_rtt_histogram().count() >= 10);
+  CHECK(gs.get_rtt_histogram().max() < 100ms);
+
+  simple_web_game_server::latency_histogram player_rtt;
+  CHECK(gs.get_player_rtt(combined_id{ 5, 0 }, player_rtt));
+  CHECK(player_rtt.count() >= 5);
+  CHECK(player_rtt.count() < gs.get_rtt_histogram().count());
+
+  simple_web_game_server::latency_histogram session_rtt;
+  CHECK(gs.get_session_rtt(0, session_rtt));
+  CHECK(session_rtt.count() > player_rtt.count());
+
+  simple_web_game_server::latency_histogram unknown_rtt;
+  CHECK(!gs.get_player_rtt(combined_id{ 6, 0 }, unknown_rtt));
+  CHECK(!gs.get_session_rtt(1, unknown_rtt));
+
+  client_a.disconnect();
+  client_b.disconnect();
+  client_a_thr.join();
+  client_b_thr.join();
+
+  std::this_thread::sleep_for(100ms);
+
+  CHECK(!gs.get_player_rtt(combined_id{ 5, 0 }, player_rtt));
+  CHECK(oss.str() == std::string{""});
+
+  gs.stop();
+
+  msg_process_thr.join();
+  game_thr.join();
+  server_thr.join();
+}
+
+TEST_CASE("the server should batch the frames sent to a player in one tick") {
+  using namespace std::chrono_literals;
+
+  using game_client = simple_web_game_server::client<
+      asio_client_no_logs
+    >;
+
+  using game_server = simple_web_game_server::game_server<
+      test_game,
+      jwt::default_clock,
+      nlohmann_traits,
+      asio_no_logs
+    >;
+
+  using combined_id = test_game::player_traits::id;
+  using player_id = combined_id::player_id;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  std::string secret = "secret";
+  std::string issuer = "jwt-gs-text";
+  jwt::verifier<jwt::default_clock, nlohmann_traits> 
+    verifier(jwt::default_clock{});
+  verifier.allow_algorithm(jwt::algorithm::hs256(secret))
+    .with_issuer(issuer);
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+
+  auto sign_result = [](combined_id id, const json& data){
+      return json{ { "pid", id.player }, { "sid", id.session } }.dump();
+    };
+
+  game_server gs{verifier, sign_result};
+
+  std::thread server_thr{bind(&game_server::run, &gs, SERVER_PORT, true)};
+  while(!gs.is_running()) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::thread msg_process_thr{bind(&game_server::process_messages, &gs)};
+  std::thread game_thr{bind(&game_server::update_games, &gs, 50ms)};
+
+  std::vector<player_id> player_list = { 3 };
+  std::vector<std::string> tokens;
+  create_game_tokens(tokens, player_list, secret, issuer, 1);
+
+  constexpr std::size_t MESSAGE_COUNT = 500;
+  std::atomic<std::size_t> echo_count{ 0 };
+
+  game_client client;
+  client.set_message_handler([&](const std::string&) { ++echo_count; });
+  std::thread client_thr{bind(&game_client::connect, &client, uri, tokens[0])};
+
+  std::this_thread::sleep_for(200ms);
+
+  // the echoes of messages arriving between updates are sent in one tick
+  json msg = { { "type", "echo" }, { "data", "ping" } };
+  for(std::size_t i = 0; i < MESSAGE_COUNT; i++) {
+    client.send(msg.dump());
+  }
+
+  for(int i = 0; i < 100 && echo_count < MESSAGE_COUNT; i++) {
+    std::this_thread::sleep_for(10ms);
+  }
+
+  CHECK(echo_count == MESSAGE_COUNT);
+
+  game_server::write_stats stats = gs.get_write_stats();
+  CHECK(stats.frames >= MESSAGE_COUNT);
+  CHECK(stats.writes > 0);
+  CHECK(stats.writes < stats.frames);
+  CHECK(stats.frames_per_write() > 2);
+
+  client.disconnect();
+  client_thr.join();
+
+  std::this_thread::sleep_for(100ms);
+
+  // the counts of closed connections are kept
+  game_server::write_stats closed_stats = gs.get_write_stats();
+  CHECK(closed_stats.frames >= stats.frames);
+  CHECK(closed_stats.writes >= stats.writes);
+  CHECK(oss.str() == std::string{""});
+
+  gs.stop();
+
+  msg_process_thr.join();
+  game_thr.join();
+  server_thr.join();
+}
+
+TEST_CASE("running games should be handed off to a peer server") {
+  using namespace std::chrono_literals;
+
+  using game_client = simple_web_game_server::client<
+      asio_client_no_logs
+    >;
+
+  using game_server = simple_web_game_server::game_server<
+      test_game,
+      jwt::default_clock,
+      nlohmann_traits,
+      asio_no_logs
+    >;
+
+  struct test_client_data {
+    test_client_data() : is_connected(false) {}
+
+    void on_open() {
+      is_connected = true;
+    }
+    void on_close() {
+      is_connected = false;
+    }
+    void on_message(const std::string& message) {
+      messages.push_back(message);
+    }
+
+    bool is_connected;
+    std::vector<std::string> messages;
+  };
+
+  using combined_id = test_game::player_traits::id;
+  using player_id = combined_id::player_id;
+
+  namespace asio = websocketpp::lib::asio;
+  using local_protocol = asio::local::stream_protocol;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  std::string secret = "secret";
+  std::string issuer = "jwt-gs-text";
+  jwt::verifier<jwt::default_clock, nlohmann_traits> 
+    verifier(jwt::default_clock{});
+  verifier.allow_algorithm(jwt::algorithm::hs256(secret))
+    .with_issuer(issuer);
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+  std::string peer_uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT + 1);
+  const std::string socket_path = "/tmp/simple_web_game_server_test.sock";
+
+  auto sign_result = [](combined_id id, const json& data){
+      return json{
+          { "pid", id.player }, { "sid", id.session }, { "data", data }
+        }.dump();
+    };
+
+  game_server gs{verifier, sign_result};
+  game_server peer{verifier, sign_result};
+
+  std::thread server_thr{bind(&game_server::run, &gs, SERVER_PORT, true)};
+  std::thread peer_thr{bind(&game_server::run, &peer, SERVER_PORT + 1, true)};
+  while(!gs.is_running() || !peer.is_running()) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::thread msg_process_thr{bind(&game_server::process_messages, &gs)};
+  std::thread game_thr{bind(&game_server::update_games, &gs, 10ms)};
+  std::thread peer_msg_process_thr{bind(&game_server::process_messages, &peer)};
+  std::thread peer_game_thr{bind(&game_server::update_games, &peer, 10ms)};
+
+  std::vector<player_id> player_list = { 12, 7, 451, 3 };
+  const std::size_t PLAYER_COUNT = player_list.size();
+  const std::size_t GAME_SIZE = 2;
+  std::vector<std::string> tokens;
+  create_game_tokens(tokens, player_list, secret, issuer, GAME_SIZE);
+
+  std::deque<game_client> clients;
+  std::vector<test_client_data> client_data_list;
+  std::vector<std::thread> client_threads;
+  create_clients<player_id, game_client, test_client_data>(
+      clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT
+    );
+
+  std::this_thread::sleep_for(100ms + 20ms * PLAYER_COUNT);
+
+  REQUIRE(gs.get_player_count() == PLAYER_COUNT);
+  REQUIRE(gs.get_game_count() == PLAYER_COUNT / GAME_SIZE);
+
+  // checks that the games still run here by echoing a message
+  auto check_games_resumed = [&]() {
+      CHECK(gs.get_game_count() == PLAYER_COUNT / GAME_SIZE);
+      CHECK(peer.get_game_count() == 0);
+
+      json msg = { { "type", "echo" }, { "data", "resumed" } };
+      clients[0].send(msg.dump());
+      std::this_thread::sleep_for(100ms);
+
+      REQUIRE(client_data_list[0].messages.size() == 1);
+      CHECK(client_data_list[0].messages.back() == msg.dump());
+      CHECK(gs.get_player_count() == PLAYER_COUNT);
+    };
+
+  SUBCASE("the peer should run the games and players get the result") {
+    json result_data = { { "port", SERVER_PORT + 1 } };
+
+    auto received = std::async(std::launch::async, [&]() {
+        return peer.receive_games(socket_path, 2s);
+      });
+    std::this_thread::sleep_for(100ms);
+
+    CHECK(gs.handoff_games(socket_path, result_data, 2s) == 2);
+    CHECK(received.get() == 2);
+    CHECK(gs.get_game_count() == 0);
+    CHECK(peer.get_game_count() == 2);
+
+    std::this_thread::sleep_for(200ms);
+
+    CHECK(gs.get_player_count() == 0);
+    for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+      CHECK(!clients[i].is_running());
+      REQUIRE(client_data_list[i].messages.size() == 1);
+      CHECK(client_data_list[i].messages.back() == sign_result(
+          { player_list[i], i / GAME_SIZE }, result_data
+        ));
+    }
+
+    // the players rejoin their games on the peer
+    std::deque<game_client> peer_clients;
+    std::vector<test_client_data> peer_client_data_list;
+    std::vector<std::thread> peer_client_threads;
+    create_clients<player_id, game_client, test_client_data>(
+        peer_clients, peer_client_data_list, peer_client_threads, tokens,
+        peer_uri, PLAYER_COUNT
+      );
+
+    std::this_thread::sleep_for(100ms + 20ms * PLAYER_COUNT);
+
+    CHECK(peer.get_player_count() == PLAYER_COUNT);
+    CHECK(peer.get_game_count() == 2);
+
+    json msg = { { "type", "stop" } };
+    for(std::size_t i = 0; i < PLAYER_COUNT / GAME_SIZE; i++) {
+      peer_clients[i * GAME_SIZE].send(msg.dump());
+    }
+    for(std::thread& client_thread : peer_client_threads) {
+      client_thread.join();
+    }
+
+    std::this_thread::sleep_for(100ms);
+    CHECK(peer.get_game_count() == 0);
+    CHECK(oss.str() == std::string{""});
+  }
+
+  SUBCASE("games should resume when no peer is listening") {
+    CHECK(gs.handoff_games(socket_path + ".missing", json{}, 500ms) == 0);
+    CHECK(oss.str().find("error handing off games") != std::string::npos);
+    check_games_resumed();
+  }
+
+  SUBCASE("games should resume when the peer times out") {
+    std::remove(socket_path.c_str());
+    asio::io_service ios;
+    local_protocol::acceptor acceptor{
+        ios, local_protocol::endpoint{socket_path}
+      };
+    local_protocol::socket socket{ios};
+    std::thread stalled_peer_thr{[&]() { acceptor.accept(socket); }};
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(gs.handoff_games(socket_path, json{}, 300ms) == 0);
+    CHECK(std::chrono::steady_clock::now() - start < 1s);
+    CHECK(oss.str().find("read timed out") != std::string::npos);
+    stalled_peer_thr.join();
+    std::remove(socket_path.c_str());
+
+    check_games_resumed();
+  }
+
+  for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+    try {
+      clients[i].disconnect();
+    } catch(game_client::client_error& e) {}
+  }
+
+  for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+    client_threads[i].join();
+  }
+
+  gs.stop();
+  peer.stop();
+
+  msg_process_thr.join();
+  game_thr.join();
+  server_thr.join();
+  peer_msg_process_thr.join();
+  peer_game_thr.join();
+  peer_thr.join();
+}
+
+TEST_CASE("a draining server should finish its games and stop") {
+  using namespace std::chrono_literals;
+
+  using game_client = simple_web_game_server::client<
+      asio_client_no_logs
+    >;
+
+  using game_server = simple_web_game_server::game_server<
+      test_game,
+      jwt::default_clock,
+      nlohmann_traits,
+      asio_no_logs
+    >;
+
+  using combined_id = test_game::player_traits::id;
+  using player_id = combined_id::player_id;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  std::string secret = "secret";
+  std::string issuer = "jwt-gs-text";
+  jwt::verifier<jwt::default_clock, nlohmann_traits> 
+    verifier(jwt::default_clock{});
+  verifier.allow_algorithm(jwt::algorithm::hs256(secret))
+    .with_issuer(issuer);
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+
+  auto sign_result = [](combined_id id, const json& data){
+      return json{ { "pid", id.player }, { "sid", id.session } }.dump();
+    };
+
+  game_server gs{verifier, sign_result};
+
+  std::thread server_thr{bind(&game_server::run, &gs, SERVER_PORT, true)};
+  while(!gs.is_running()) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::thread msg_process_thr{bind(&game_server::process_messages, &gs)};
+  std::thread game_thr{bind(&game_server::update_games, &gs, 10ms)};
+
+  // the last two tokens are for a second session that connects after draining
+  std::vector<player_id> player_list = { 21, 4, 60, 9 };
+  std::vector<std::string> tokens;
+  create_game_tokens(tokens, player_list, secret, issuer, 2);
+
+  std::atomic<std::size_t> echo_count{ 0 };
+  game_client client_a;
+  game_client client_b;
+  client_a.set_message_handler([&](const std::string& msg) {
+      if(msg.find("echo") != std::string::npos) {
+        ++echo_count;
+      }
+    });
+  std::thread client_a_thr{
+      bind(&game_client::connect, &client_a, uri, tokens[0])
+    };
+  std::thread client_b_thr{
+      bind(&game_client::connect, &client_b, uri, tokens[1])
+    };
+
+  std::this_thread::sleep_for(200ms);
+
+  REQUIRE(gs.get_game_count() == 1);
+  gs.drain();
+  CHECK(gs.is_draining());
+
+  // clients for any new session are turned away
+  CHECK(get_close_reason<asio_client_no_logs>(uri, tokens[2])
+    == simple_web_game_server::default_close_reasons::server_shutdown());
+  CHECK(gs.get_game_count() == 1);
+
+  // the running game keeps being updated
+  json msg = { { "type", "echo" } };
+  client_a.send(msg.dump());
+  std::this_thread::sleep_for(100ms);
+  CHECK(echo_count == 1);
+  CHECK(gs.is_running());
+
+  // the server stops by itself once the game ends and its players leave
+  client_a.send(json{ { "type", "stop" } }.dump());
+  client_a_thr.join();
+  client_b_thr.join();
+
+  for(int i = 0; i < 100 && gs.is_running(); i++) {
+    std::this_thread::sleep_for(10ms);
+  }
+
+  CHECK(!gs.is_running());
+  CHECK(gs.get_game_count() == 0);
+  CHECK(oss.str() == std::string{""});
+
+  msg_process_thr.join();
+  game_thr.join();
+  server_thr.join();
+}
+
+TEST_CASE("slow game updates should be handled by the slow update policy") {
+  using namespace std::chrono_literals;
+  using simple_web_game_server::slow_update_policy;
+
+  using game_client = simple_web_game_server::client<
+      asio_client_no_logs
+    >;
+
+  using game_server = simple_web_game_server::game_server<
+      test_game,
+      jwt::default_clock,
+      nlohmann_traits,
+      asio_no_logs
+    >;
+
+  struct test_client_data {
+    test_client_data() : is_connected(false) {}
+
+    void on_open() {
+      is_connected = true;
+    }
+    void on_close() {
+      is_connected = false;
+    }
+    void on_message(const std::string& message) {
+      messages.push_back(message);
+    }
+
+    bool is_connected;
+    std::vector<std::string> messages;
+  };
+
+  using combined_id = test_game::player_traits::id;
+  using player_id = combined_id::player_id;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  std::string secret = "secret";
+  std::string issuer = "jwt-gs-text";
+  jwt::verifier<jwt::default_clock, nlohmann_traits> 
+    verifier(jwt::default_clock{});
+  verifier.allow_algorithm(jwt::algorithm::hs256(secret))
+    .with_issuer(issuer);
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+
+  auto sign_result = [](combined_id id, const json& data){
+      return json{ { "pid", id.player }, { "sid", id.session } }.dump();
+    };
+
+  game_server gs{verifier, sign_result};
+
+  std::thread server_thr{bind(&game_server::run, &gs, SERVER_PORT, true)};
+  while(!gs.is_running()) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::thread msg_process_thr{bind(&game_server::process_messages, &gs)};
+  std::thread game_thr{bind(&game_server::update_games, &gs, 10ms)};
+
+  // the first player's game is made slow, the second's runs normally
+  std::vector<player_id> player_list = { 14, 15 };
+  const std::size_t PLAYER_COUNT = player_list.size();
+  std::vector<std::string> tokens;
+  create_game_tokens(tokens, player_list, secret, issuer, 1);
+
+  std::deque<game_client> clients;
+  std::vector<test_client_data> client_data_list;
+  std::vector<std::thread> client_threads;
+  create_clients<player_id, game_client, test_client_data>(
+      clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT
+    );
+
+  std::this_thread::sleep_for(100ms + 20ms * PLAYER_COUNT);
+  REQUIRE(gs.get_game_count() == 2);
+
+  const json slow_msg = { { "type", "sleep" }, { "duration", 60 } };
+  const json echo_msg = { { "type", "echo" } };
+
+  // returns the time passed to the slow game's update after the slow one
+  auto get_delta_time = [&]() {
+      for(int i = 0; i < 50 && client_data_list[0].messages.empty(); i++) {
+        std::this_thread::sleep_for(10ms);
+      }
+      REQUIRE(client_data_list[0].messages.size() == 1);
+      json reply;
+      nlohmann_traits::parse(reply, client_data_list[0].messages.back());
+      REQUIRE(reply["type"] == "delta_time");
+      return reply["delta_time"].get<long>();
+    };
+
+  // checks that the normal game is still updated
+  auto check_other_game = [&]() {
+      clients[1].send(echo_msg.dump());
+      std::this_thread::sleep_for(100ms);
+      REQUIRE(client_data_list[1].messages.size() == 1);
+      CHECK(client_data_list[1].messages.back() == echo_msg.dump());
+    };
+
+  SUBCASE("terminate should end the slow game and notify its players") {
+    gs.set_update_budget(20ms, slow_update_policy::terminate);
+    clients[0].send(slow_msg.dump());
+    client_threads[0].join();
+
+    CHECK(gs.get_slow_update_count() == 1);
+    REQUIRE(client_data_list[0].messages.size() == 1);
+    CHECK(client_data_list[0].messages.back()
+      == sign_result({ player_list[0], 0 }, json{}));
+    CHECK(oss.str().find("terminating game session 0") != std::string::npos);
+
+    std::this_thread::sleep_for(100ms);
+    CHECK(gs.get_game_count() == 1);
+    check_other_game();
+  }
+
+  SUBCASE("skip_tick should skip the slow game's next update") {
+    gs.set_update_budget(20ms, slow_update_policy::skip_tick);
+    clients[0].send(slow_msg.dump());
+
+    // the time of the skipped tick, at least the slow update, is dropped
+    CHECK(get_delta_time() < 60);
+    CHECK(gs.get_slow_update_count() == 1);
+    CHECK(gs.get_game_count() == 2);
+    check_other_game();
+    CHECK(oss.str() == std::string{""});
+  }
+
+  SUBCASE("defer should pass the skipped time to the following update") {
+    gs.set_update_budget(20ms, slow_update_policy::defer);
+    clients[0].send(slow_msg.dump());
+
+    // the skipped tick lasted as long as the slow update, and the next tick
+    // at least one time-step
+    CHECK(get_delta_time() >= 70);
+    CHECK(gs.get_slow_update_count() == 1);
+    CHECK(gs.get_game_count() == 2);
+    check_other_game();
+    CHECK(oss.str() == std::string{""});
+  }
+
+  for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+    try {
+      clients[i].disconnect();
+    } catch(game_client::client_error& e) {}
+  }
+
+  for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+    if(client_threads[i].joinable()) {
+      client_threads[i].join();
+    }
+  }
+
+  gs.stop();
+
+  msg_process_thr.join();
+  game_thr.join();
+  server_thr.join();
+}
@@ -0,0 +1,69 @@
+#include <doctest/doctest.h>
+
+#include <simple_web_game_server/latency_histogram.hpp>
+
+#include <chrono>
+
+TEST_CASE("latency_histogram should report bounded percentiles") {
+  using namespace std::chrono_literals;
+  using simple_web_game_server::latency_histogram;
+
+  latency_histogram histogram;
+
+  SUBCASE("an empty histogram should report zero durations") {
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.percentile(50).count() == 0);
+    CHECK(histogram.max().count() == 0);
+    CHECK(histogram.mean().count() == 0);
+  }
+
+  SUBCASE("small durations should be recorded exactly") {
+    for(long i = 0; i < 8; ++i) {
+      histogram.record(std::chrono::microseconds{ i });
+    }
+
+    CHECK(histogram.count() == 8);
+    CHECK(histogram.percentile(0).count() == 0);
+    CHECK(histogram.percentile(50).count() == 4);
+    CHECK(histogram.percentile(100).count() == 7);
+    CHECK(histogram.max().count() == 7);
+  }
+
+  SUBCASE("percentiles should be within 12.5% above the true value") {
+    for(long i = 1; i <= 1000; ++i) {
+      histogram.record(std::chrono::microseconds{ i * 10 });
+    }
+
+    const long p50 = histogram.percentile(50).count();
+    const long p99 = histogram.percentile(99).count();
+
+    CHECK(p50 >= 5000);
+    CHECK(p50 <= 5000 * 9 / 8);
+    CHECK(p99 >= 9900);
+    CHECK(p99 <= 10000);
+    CHECK(histogram.max().count() == 10000);
+    CHECK(histogram.mean().count() == 5005);
+  }
+
+  SUBCASE("durations should be converted to microseconds") {
+    histogram.record(3ms);
+    histogram.record(2500ns);
+
+    CHECK(histogram.max().count() == 3000);
+    CHECK(histogram.percentile(0).count() == 2);
+  }
+
+  SUBCASE("merged histograms should combine counts and maxima") {
+    latency_histogram other;
+    histogram.record(10us);
+    other.record(20us);
+    other.record(1s);
+    histogram.merge(other);
+
+    CHECK(histogram.count() == 3);
+    CHECK(histogram.max() == 1s);
+
+    histogram.clear();
+    CHECK(histogram.count() == 0);
+  }
+}
@@ -1,2 +1,5 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+// the vendored doctest sizes its signal stack with SIGSTKSZ, which is not a
+// constant since glibc 2.34
+#define DOCTEST_CONFIG_NO_POSIX_SIGNALS
 #include <doctest/doctest.h>
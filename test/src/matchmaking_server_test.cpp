@@ -7,12 +7,14 @@
 #include <jwt-cpp/jwt.h>
 
 #include <simple_web_game_server/matchmaking_server.hpp>
+#include <simple_web_game_server/rating_matchmaker.hpp>
 #include <simple_web_game_server/client.hpp>
 #include <json_traits/nlohmann_traits.hpp>
 
 #include <websocketpp_configs/asio_no_logs.hpp>
 #include <websocketpp_configs/asio_client_no_logs.hpp>
 
+#include <deque>
 #include <thread>
 #include <functional>
 #include <sstream>
@@ -135,7 +137,7 @@ TEST_CASE("players should interact with the server with no errors") {
   CHECK(oss.str() == std::string{""});
 
   std::size_t PLAYER_COUNT;
-  std::vector<test_client> clients;
+  std::deque<test_client> clients;
   std::vector<test_client_data> client_data_list;
   std::vector<std::thread> client_threads;
   std::vector<std::string> tokens;
@@ -290,6 +292,94 @@ TEST_CASE("players should interact with the server with no errors") {
     CHECK(oss.str() == std::string{""});
   }
 
+  SUBCASE("sessions in different queues should not be matched together") {
+    using claim = jwt::basic_claim<nlohmann_traits>;
+
+    mms.set_queue_key_function([](const json& data) {
+        return data.at("mode").get<std::string>();
+      });
+
+    std::vector<combined_id> player_list{ { 12, 20 }, { 13, 21 }, { 14, 22 } };
+    std::vector<std::string> modes{ "ranked", "casual", "ranked" };
+    PLAYER_COUNT = player_list.size();
+
+    for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+      json data;
+      data["mode"] = modes[i];
+      tokens.push_back(jwt::create<nlohmann_traits>()
+          .set_issuer(issuer)
+          .set_payload_claim("pid", claim(player_list[i].player))
+          .set_payload_claim("sid", claim(player_list[i].session))
+          .set_payload_claim("data", claim(data))
+          .sign(jwt::algorithm::hs256{secret})
+        );
+    }
+
+    create_clients<player_id, test_client, test_client_data>(
+        clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT
+      );
+
+    std::this_thread::sleep_for(1000ms);
+
+    CHECK(mms.get_queue_count() == 2);
+    CHECK(mms.get_player_count() == 1);
+    CHECK(client_data_list[0].last_message != "");
+    CHECK(client_data_list[1].last_message == "");
+    CHECK(client_data_list[2].last_message != "");
+    CHECK(oss.str() == std::string{""});
+  }
+
+  SUBCASE("sessions without a queue key should be cancelled") {
+    using claim = jwt::basic_claim<nlohmann_traits>;
+
+    mms.set_queue_key_function([](const json& data) {
+        return data.at("mode").get<std::string>();
+      });
+
+    std::vector<combined_id> player_list{ { 15, 23 } };
+    PLAYER_COUNT = player_list.size();
+
+    tokens.push_back(jwt::create<nlohmann_traits>()
+        .set_issuer(issuer)
+        .set_payload_claim("pid", claim(player_list[0].player))
+        .set_payload_claim("sid", claim(player_list[0].session))
+        .set_payload_claim("data", claim(json::object()))
+        .sign(jwt::algorithm::hs256{secret})
+      );
+
+    create_clients<player_id, test_client, test_client_data>(
+        clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT
+      );
+
+    std::this_thread::sleep_for(500ms);
+
+    CHECK(mms.get_queue_count() == 0);
+    CHECK(client_data_list[0].last_message != "");
+    CHECK(oss.str() == std::string{""});
+  }
+
+  SUBCASE("queued sessions should be sent their queue status") {
+    mms.set_queue_status_interval(50ms);
+
+    std::vector<combined_id> player_list{ { 15, 30 } };
+    PLAYER_COUNT = player_list.size();
+
+    create_matchmaker_tokens(tokens, player_list, secret, issuer);
+
+    create_clients<player_id, test_client, test_client_data>(
+        clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT
+      );
+
+    std::this_thread::sleep_for(500ms);
+
+    json status;
+    nlohmann_traits::parse(status, client_data_list[0].last_message);
+    CHECK(status["type"] == "queue_status");
+    CHECK(status["position"] == 1);
+    CHECK(status["queue_size"] == 1);
+    CHECK(oss.str() == std::string{""});
+  }
+
   // end of test cleanup
 
   for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
@@ -316,3 +406,312 @@ TEST_CASE("players should interact with the server with no errors") {
   match_thr.join();
   server_thr.join();
 }
+
+TEST_CASE("a draining matchmaking server should match its queue and stop") {
+  using namespace std::chrono_literals;
+
+  using test_client = simple_web_game_server::client<
+      asio_client_no_logs
+    >;
+
+  // a rating difference of 150 is accepted after one second of waiting
+  struct slow_rating_traits : simple_web_game_server::default_rating_traits {
+    static constexpr double window_growth() {
+      return 100.0;
+    }
+  };
+
+  using test_matchmaking_server = simple_web_game_server::matchmaking_server<
+      simple_web_game_server::rating_matchmaker<
+        test_player_traits, json, slow_rating_traits
+      >,
+      jwt::default_clock,
+      nlohmann_traits,
+      asio_no_logs
+    >;
+
+  struct test_client_data {
+    test_client_data() : is_connected(false) {}
+
+    void on_open() {
+      is_connected = true;
+    }
+    void on_close() {
+      is_connected = false;
+    }
+    void on_message(const std::string& message) {
+      last_message = message;
+    }
+
+    bool is_connected;
+    std::string last_message;
+  };
+
+  using combined_id = test_game::player_traits::id;
+  using player_id = combined_id::player_id;
+  using claim = jwt::basic_claim<nlohmann_traits>;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  const std::string secret = "secret";
+  const std::string issuer = "jwt-gs-text";
+  jwt::verifier<jwt::default_clock, nlohmann_traits> 
+    verifier(jwt::default_clock{});
+  verifier.allow_algorithm(jwt::algorithm::hs256(secret))
+    .with_issuer(issuer);
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+
+  auto sign_game = [](const combined_id& id, const json& data){
+      return json{
+          { "pid", id.player }, { "sid", id.session }, { "data", data }
+        }.dump();
+    };
+
+  test_matchmaking_server mms{verifier, sign_game};
+
+  std::thread server_thr{
+      bind(&test_matchmaking_server::run, &mms, SERVER_PORT, true)
+    };
+  while(!mms.is_running()) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::thread msg_process_thr{
+      bind(&test_matchmaking_server::process_messages, &mms)
+    };
+  std::thread match_thr{
+      bind(&test_matchmaking_server::match_players, &mms, 10ms)
+    };
+
+  // the first two sessions match after a wait, the third never matches, and
+  // the last connects after draining
+  std::vector<combined_id> player_list{
+      { 70, 50 }, { 71, 51 }, { 72, 52 }, { 73, 53 }
+    };
+  std::vector<double> ratings{ 1000, 1150, 3000, 1000 };
+  std::vector<std::string> tokens;
+  for(std::size_t i = 0; i < player_list.size(); i++) {
+    tokens.push_back(jwt::create<nlohmann_traits>()
+        .set_issuer(issuer)
+        .set_payload_claim("pid", claim(player_list[i].player))
+        .set_payload_claim("sid", claim(player_list[i].session))
+        .set_payload_claim("data", claim(json{ { "rating", ratings[i] } }))
+        .sign(jwt::algorithm::hs256{secret})
+      );
+  }
+
+  const std::size_t PLAYER_COUNT = 3;
+  std::deque<test_client> clients;
+  std::vector<test_client_data> client_data_list;
+  std::vector<std::thread> client_threads;
+  create_clients<player_id, test_client, test_client_data>(
+      clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT
+    );
+
+  std::this_thread::sleep_for(200ms);
+
+  REQUIRE(mms.get_player_count() == PLAYER_COUNT);
+  mms.drain();
+  CHECK(mms.is_draining());
+
+  // clients for any new session are turned away
+  CHECK(get_close_reason<asio_client_no_logs>(uri, tokens[3])
+    == simple_web_game_server::default_close_reasons::server_shutdown());
+
+  // the queued sessions are still matched
+  std::this_thread::sleep_for(100ms);
+  CHECK(mms.is_running());
+  CHECK(mms.get_player_count() == PLAYER_COUNT);
+
+  for(std::thread& client_thread : client_threads) {
+    client_thread.join();
+  }
+
+  for(int i = 0; i < 100 && mms.is_running(); i++) {
+    std::this_thread::sleep_for(10ms);
+  }
+
+  // the sessions left unmatched are cancelled and the server stops itself
+  CHECK(!mms.is_running());
+  for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+    json result;
+    nlohmann_traits::parse(result, client_data_list[i].last_message);
+    CHECK(result["pid"] == player_list[i].player);
+    CHECK(result["data"]["matched"] == (i < 2));
+  }
+  CHECK(oss.str() == std::string{""});
+
+  msg_process_thr.join();
+  match_thr.join();
+  server_thr.join();
+}
+
+TEST_CASE("an incremental matchmaker should follow the queue") {
+  using namespace std::chrono_literals;
+
+  using test_client = simple_web_game_server::client<
+      asio_client_no_logs
+    >;
+
+  using test_matchmaking_server = simple_web_game_server::matchmaking_server<
+      test_incremental_matchmaker,
+      jwt::default_clock,
+      nlohmann_traits,
+      asio_no_logs
+    >;
+
+  struct test_client_data {
+    test_client_data() : is_connected(false) {}
+
+    void on_open() {
+      is_connected = true;
+    }
+    void on_close() {
+      is_connected = false;
+    }
+    void on_message(const std::string& message) {
+      last_message = message;
+    }
+
+    bool is_connected;
+    std::string last_message;
+  };
+
+  using combined_id = test_game::player_traits::id;
+  using player_id = combined_id::player_id;
+  using session_id = combined_id::session_id;
+
+  // setup logging sink to track errors
+  std::ostringstream oss;
+  auto ostream_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
+  auto logger = std::make_shared<spdlog::logger>("my_logger", ostream_sink);
+  spdlog::set_default_logger(logger);
+  spdlog::set_level(spdlog::level::err);
+
+  const std::string secret = "secret";
+  const std::string issuer = "jwt-gs-text";
+  jwt::verifier<jwt::default_clock, nlohmann_traits> 
+    verifier(jwt::default_clock{});
+  verifier.allow_algorithm(jwt::algorithm::hs256(secret))
+    .with_issuer(issuer);
+
+  std::string uri = std::string{"ws://localhost:"}
+    + std::to_string(SERVER_PORT);
+
+  auto sign_game = [](const combined_id& id, const json& data){
+      return json{
+          { "pid", id.player }, { "sid", id.session }, { "data", data }
+        }.dump();
+    };
+
+  test_matchmaking_server mms{verifier, sign_game};
+
+  std::thread server_thr{
+      bind(&test_matchmaking_server::run, &mms, SERVER_PORT, true)
+    };
+  while(!mms.is_running()) {
+    std::this_thread::sleep_for(10ms);
+  }
+  std::thread msg_process_thr{
+      bind(&test_matchmaking_server::process_messages, &mms)
+    };
+  std::thread match_thr{
+      bind(&test_matchmaking_server::match_players, &mms, 10ms)
+    };
+
+  std::size_t PLAYER_COUNT = 0;
+  std::deque<test_client> clients;
+  std::vector<test_client_data> client_data_list;
+  std::vector<std::thread> client_threads;
+  std::vector<std::string> tokens;
+
+  // returns the game session id each player was sent
+  auto get_game_sessions = [&]() {
+      vector<session_id> game_sessions;
+      for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+        json result;
+        nlohmann_traits::parse(result, client_data_list[i].last_message);
+        CHECK(result["data"]["matched"] == true);
+        game_sessions.push_back(result["sid"].get<session_id>());
+      }
+      return game_sessions;
+    };
+
+  SUBCASE("joining sessions should be matched in pairs") {
+    std::vector<combined_id> player_list{
+        { 90, 60 }, { 91, 61 }, { 92, 62 }, { 93, 63 }
+      };
+    PLAYER_COUNT = player_list.size();
+    create_matchmaker_tokens(tokens, player_list, secret, issuer);
+
+    create_clients<player_id, test_client, test_client_data>(
+        clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT,
+        20
+      );
+
+    std::this_thread::sleep_for(200ms);
+
+    CHECK(mms.get_player_count() == 0);
+    vector<session_id> game_sessions = get_game_sessions();
+    CHECK(game_sessions[0] == game_sessions[1]);
+    CHECK(game_sessions[2] == game_sessions[3]);
+    CHECK(game_sessions[0] != game_sessions[2]);
+    CHECK(oss.str() == std::string{""});
+  }
+
+  SUBCASE("a session leaving before it is matched should not be matched") {
+    std::vector<combined_id> player_list{ { 94, 64 } };
+    create_matchmaker_tokens(tokens, player_list, secret, issuer);
+
+    test_client leaving_client;
+    std::thread leaving_client_thr{
+        bind(&test_client::connect, &leaving_client, uri, tokens[0])
+      };
+    std::this_thread::sleep_for(100ms);
+    CHECK(mms.get_player_count() == 1);
+
+    leaving_client.disconnect();
+    leaving_client_thr.join();
+    std::this_thread::sleep_for(100ms);
+    CHECK(mms.get_player_count() == 0);
+
+    // the remaining sessions are matched with each other
+    player_list = { { 95, 65 }, { 96, 66 } };
+    tokens.clear();
+    create_matchmaker_tokens(tokens, player_list, secret, issuer);
+    PLAYER_COUNT = player_list.size();
+
+    create_clients<player_id, test_client, test_client_data>(
+        clients, client_data_list, client_threads, tokens, uri, PLAYER_COUNT
+      );
+
+    std::this_thread::sleep_for(200ms);
+
+    CHECK(mms.get_player_count() == 0);
+    vector<session_id> game_sessions = get_game_sessions();
+    CHECK(game_sessions[0] == game_sessions[1]);
+    CHECK(oss.str() == std::string{""});
+  }
+
+  for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+    try {
+      clients[i].disconnect();
+    } catch(test_client::client_error& e) {}
+  }
+
+  for(std::size_t i = 0; i < PLAYER_COUNT; i++) {
+    client_threads[i].join();
+  }
+
+  mms.stop();
+
+  msg_process_thr.join();
+  match_thr.join();
+  server_thr.join();
+}
@@ -0,0 +1,107 @@
+#include <doctest/doctest.h>
+
+#include <simple_web_game_server/min_cost_matchmaker.hpp>
+
+#include "test_game.hpp"
+
+#include <algorithm>
+
+TEST_CASE("min_cost_matchmaker should minimize the total match cost") {
+  using simple_web_game_server::min_cost_matchmaker;
+  using matchmaker = min_cost_matchmaker<test_player_traits, json>;
+  using session_id = matchmaker::session_id;
+
+  matchmaker mm;
+  vector<matchmaker::game> games;
+  vector<matchmaker::message> messages;
+
+  auto join = [&](session_id sid, double rating, const std::string& region) {
+    json data;
+    data["rating"] = rating;
+    data["region"] = region;
+    matchmaker::session_data d{ data };
+    REQUIRE(d.is_valid());
+    mm.on_join(sid, d);
+  };
+
+  auto sorted_pairs = [&]() {
+    vector<vector<session_id> > pairs;
+    for(auto& g : games) {
+      vector<session_id> sids = std::get<0>(g);
+      std::sort(sids.begin(), sids.end());
+      pairs.push_back(sids);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+  };
+
+  SUBCASE("session data without a rating should be invalid") {
+    CHECK(!matchmaker::session_data{ json::object() }.is_valid());
+  }
+
+  SUBCASE("pairs should be chosen globally rather than greedily") {
+    // greedily pairing the closest sessions 2 and 3 would leave 1 and 4
+    // too far apart to match at all
+    join(1, 1000, "eu");
+    join(2, 1040, "eu");
+    join(3, 1070, "eu");
+    join(4, 1110, "eu");
+
+    mm.match(games, messages, 0);
+
+    CHECK(sorted_pairs() == vector<vector<session_id> >{ { 1, 2 }, { 3, 4 } });
+    CHECK(mm.size() == 0);
+    CHECK(mm.get_solve_time_histogram().count() == 1);
+  }
+
+  SUBCASE("sessions should prefer partners in the same region") {
+    join(1, 1000, "eu");
+    join(2, 1010, "na");
+    join(3, 1020, "eu");
+    join(4, 1030, "na");
+
+    mm.match(games, messages, 0);
+
+    CHECK(sorted_pairs() == vector<vector<session_id> >{ { 1, 3 }, { 2, 4 } });
+  }
+
+  SUBCASE("expensive pairs should wait until the wait time lowers the cost") {
+    // a cost of 150 falls below 100 after 2.5s waited by each session
+    join(1, 1000, "eu");
+    join(2, 1150, "eu");
+
+    mm.match(games, messages, 0);
+    mm.match(games, messages, 2000);
+    CHECK(games.empty());
+    CHECK(mm.size() == 2);
+
+    mm.match(games, messages, 1000);
+    CHECK(sorted_pairs() == vector<vector<session_id> >{ { 1, 2 } });
+  }
+
+  SUBCASE("joining sessions should not be credited with idle time") {
+    mm.match(games, messages, 60000);
+
+    join(1, 1000, "eu");
+    join(2, 1150, "eu");
+    REQUIRE(mm.can_match());
+
+    // the tick after an idle stretch carries it in its delta time
+    mm.match(games, messages, 10000);
+    CHECK(games.empty());
+    CHECK(mm.size() == 2);
+
+    mm.match(games, messages, 2600);
+    CHECK(sorted_pairs() == vector<vector<session_id> >{ { 1, 2 } });
+  }
+
+  SUBCASE("leaving sessions should not be matched") {
+    join(1, 1000, "eu");
+    join(2, 1010, "eu");
+    join(3, 1020, "eu");
+    mm.on_leave(2);
+
+    mm.match(games, messages, 0);
+    CHECK(sorted_pairs() == vector<vector<session_id> >{ { 1, 3 } });
+  }
+}
@@ -0,0 +1,118 @@
+#include <doctest/doctest.h>
+
+#include <simple_web_game_server/party_matchmaker.hpp>
+
+#include "test_game.hpp"
+
+#include <algorithm>
+
+struct three_vs_three_traits {
+  static constexpr std::size_t team_size() {
+    return 3;
+  }
+  static constexpr std::size_t team_count() {
+    return 2;
+  }
+  template<typename json_type>
+  static std::size_t get_party_size(const json_type& data) {
+    return data.value("party_size", 1);
+  }
+};
+
+TEST_CASE("party_matchmaker should pack parties into full teams") {
+  using simple_web_game_server::party_matchmaker;
+  using matchmaker = party_matchmaker<
+      test_player_traits,
+      json,
+      three_vs_three_traits
+    >;
+  using session_id = matchmaker::session_id;
+
+  matchmaker mm;
+  vector<matchmaker::game> games;
+  vector<matchmaker::message> messages;
+
+  auto join = [&](session_id sid, int party_size) {
+    json data;
+    data["party_size"] = party_size;
+    matchmaker::session_data d{ data };
+    REQUIRE(d.is_valid());
+    mm.on_join(sid, d);
+  };
+
+  auto team_sizes = [](const json& team, const unordered_map<session_id, int>& sizes) {
+    int total = 0;
+    for(auto& sid : team) {
+      total += sizes.at(sid.get<session_id>());
+    }
+    return total;
+  };
+
+  SUBCASE("parties larger than a team should be invalid") {
+    json data;
+    data["party_size"] = 4;
+    CHECK(!matchmaker::session_data{ data }.is_valid());
+    data["party_size"] = 0;
+    CHECK(!matchmaker::session_data{ data }.is_valid());
+  }
+
+  SUBCASE("solo sessions should be the default") {
+    CHECK(matchmaker::session_data{ json::object() }.party_size == 1);
+  }
+
+  SUBCASE("mixed parties should fill both teams exactly") {
+    unordered_map<session_id, int> sizes{
+      { 1, 2 }, { 2, 3 }, { 3, 1 }, { 4, 2 }
+    };
+    for(session_id sid = 1; sid <= 4; ++sid) {
+      join(sid, sizes[sid]);
+    }
+
+    REQUIRE(mm.can_match());
+    mm.match(games, messages, 0);
+
+    REQUIRE(games.size() == 1);
+    CHECK(std::get<0>(games[0]).size() == 3);
+    const json& teams = std::get<2>(games[0])["teams"];
+    REQUIRE(teams.size() == 2);
+    CHECK(team_sizes(teams[0], sizes) == 3);
+    CHECK(team_sizes(teams[1], sizes) == 3);
+
+    // the longest waiting party should always be placed
+    vector<session_id> matched = std::get<0>(games[0]);
+    CHECK(std::count(matched.begin(), matched.end(), 1) == 1);
+    CHECK(mm.size() == 1);
+  }
+
+  SUBCASE("a party should never be split across teams") {
+    join(1, 2);
+    join(2, 2);
+    join(3, 2);
+
+    mm.match(games, messages, 0);
+    CHECK(games.empty());
+    CHECK(!mm.can_match());
+
+    join(4, 1);
+    join(5, 1);
+    CHECK(mm.can_match());
+
+    mm.match(games, messages, 0);
+    REQUIRE(games.size() == 1);
+    CHECK(mm.size() == 1);
+  }
+
+  SUBCASE("leaving parties should not be matched") {
+    join(1, 3);
+    join(2, 3);
+    mm.on_leave(1);
+    join(3, 3);
+
+    mm.match(games, messages, 0);
+    REQUIRE(games.size() == 1);
+    vector<session_id> matched = std::get<0>(games[0]);
+    std::sort(matched.begin(), matched.end());
+    CHECK(matched == vector<session_id>{ 2, 3 });
+    CHECK(mm.size() == 0);
+  }
+}
@@ -0,0 +1,106 @@
+#include <doctest/doctest.h>
+
+#include <simple_web_game_server/queue_log.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST_CASE("queue_log should replay the sessions still queued") {
+  using namespace std::chrono_literals;
+  using json = nlohmann::json;
+  using log_type = simple_web_game_server::queue_log<unsigned long, json>;
+  using entry = log_type::entry;
+
+  const std::string path = "queue_log_test.log";
+  std::remove(path.c_str());
+
+  const log_type::time_point start{ 1600000000000ms };
+
+  log_type log;
+
+  SUBCASE("a missing log should be empty") {
+    CHECK(log_type::load(path).empty());
+  }
+
+  SUBCASE("sessions should be restored in the order they joined") {
+    log.open(path, {});
+    log.join(entry{ 3, "ranked", start });
+    log.join(entry{ 1, "casual", start + 5ms });
+    log.join(entry{ 2, "ranked", start + 10ms });
+    log.leave(1);
+    log.join(entry{ 4, "ranked", start + 20ms });
+    log.flush();
+
+    std::vector<entry> queued = log_type::load(path);
+    REQUIRE(queued.size() == 3);
+    CHECK(queued[0].sid == 3);
+    CHECK(queued[0].key == "ranked");
+    CHECK(queued[0].join_time == start);
+    CHECK(queued[1].sid == 2);
+    CHECK(queued[1].join_time == start + 10ms);
+    CHECK(queued[2].sid == 4);
+  }
+
+  SUBCASE("records should not be written until flushed") {
+    log.open(path, {});
+    log.join(entry{ 1, "", start });
+
+    CHECK(log_type::load(path).empty());
+
+    log.close();
+
+    CHECK(log_type::load(path).size() == 1);
+  }
+
+  SUBCASE("a torn last record should be ignored") {
+    log.open(path, {});
+    log.join(entry{ 1, "", start });
+    log.join(entry{ 2, "", start });
+    log.close();
+
+    {
+      std::ofstream file(path, std::ios::app);
+      file << "{\"op\":\"leave\",\"si";
+    }
+
+    CHECK(log_type::load(path).size() == 2);
+  }
+
+  SUBCASE("compaction should keep only the queued sessions") {
+    log.open(path, {});
+    std::vector<entry> queued;
+    for(unsigned long sid = 0; sid < 2000; ++sid) {
+      log.join(entry{ sid, "", start });
+      if(sid % 4 == 0) {
+        queued.push_back(entry{ sid, "", start });
+      } else {
+        log.leave(sid);
+      }
+    }
+
+    CHECK(log.needs_compaction(queued.size()));
+
+    log.compact(queued);
+
+    CHECK(!log.needs_compaction(queued.size()));
+
+    std::vector<entry> restored = log_type::load(path);
+    REQUIRE(restored.size() == 500);
+    CHECK(restored[1].sid == 4);
+
+    std::ifstream file(path);
+    std::size_t line_count = 0;
+    for(std::string line; std::getline(file, line); ) {
+      ++line_count;
+    }
+    CHECK(line_count == 500);
+  }
+
+  log.close();
+  std::remove(path.c_str());
+}
@@ -0,0 +1,135 @@
+#include <doctest/doctest.h>
+
+#include <simple_web_game_server/rating_matchmaker.hpp>
+
+#include "test_game.hpp"
+
+#include <algorithm>
+
+TEST_CASE("rating_matchmaker should pair sessions of similar rating") {
+  using simple_web_game_server::rating_matchmaker;
+  using matchmaker = rating_matchmaker<test_player_traits, json>;
+  using session_id = matchmaker::session_id;
+
+  matchmaker mm;
+  vector<matchmaker::game> games;
+  vector<matchmaker::message> messages;
+
+  auto join = [&](session_id sid, double rating) {
+    json data;
+    data["rating"] = rating;
+    matchmaker::session_data d{ data };
+    REQUIRE(d.is_valid());
+    mm.on_join(sid, d);
+  };
+
+  auto players_of = [](const matchmaker::game& g) {
+    vector<session_id> sids = std::get<0>(g);
+    std::sort(sids.begin(), sids.end());
+    return sids;
+  };
+
+  SUBCASE("session data without a rating should be invalid") {
+    json data;
+    data["name"] = "no rating";
+    CHECK(!matchmaker::session_data{ data }.is_valid());
+  }
+
+  SUBCASE("sessions within the initial window should match immediately") {
+    join(1, 1000);
+    join(2, 1700);
+    join(3, 1020);
+    join(4, 1690);
+
+    REQUIRE(mm.can_match());
+    mm.match(games, messages, 0);
+
+    REQUIRE(games.size() == 2);
+    vector<vector<session_id> > pairs{
+      players_of(games[0]), players_of(games[1])
+    };
+    std::sort(pairs.begin(), pairs.end());
+    CHECK(pairs[0] == vector<session_id>{ 1, 3 });
+    CHECK(pairs[1] == vector<session_id>{ 2, 4 });
+    CHECK(std::get<1>(games[0]) != std::get<1>(games[1]));
+    CHECK(mm.size() == 0);
+    CHECK(!mm.can_match());
+  }
+
+  SUBCASE("the rating window should widen with wait time") {
+    // a difference of 150 needs (150 - 50) / 25 = 4 seconds of waiting
+    join(1, 1000);
+    join(2, 1150);
+
+    mm.match(games, messages, 0);
+    mm.match(games, messages, 3000);
+    CHECK(games.empty());
+    CHECK(mm.can_match());
+
+    mm.match(games, messages, 1500);
+    REQUIRE(games.size() == 1);
+    CHECK(players_of(games[0]) == vector<session_id>{ 1, 2 });
+  }
+
+  SUBCASE("a session that already waited should keep its wider window") {
+    json data;
+    data["rating"] = 1000;
+    mm.on_join(1, matchmaker::session_data{ data }, 4000);
+    join(2, 1150);
+
+    mm.match(games, messages, 500);
+    CHECK(games.empty());
+
+    mm.match(games, messages, 1);
+    REQUIRE(games.size() == 1);
+    CHECK(players_of(games[0]) == vector<session_id>{ 1, 2 });
+  }
+
+  SUBCASE("joining sessions should not be credited with idle time") {
+    mm.match(games, messages, 60000);
+
+    join(1, 1000);
+    join(2, 1150);
+    REQUIRE(mm.can_match());
+
+    // the tick after an idle stretch carries it in its delta time
+    mm.match(games, messages, 10000);
+    CHECK(games.empty());
+    CHECK(mm.size() == 2);
+
+    mm.match(games, messages, 4001);
+    REQUIRE(games.size() == 1);
+    CHECK(players_of(games[0]) == vector<session_id>{ 1, 2 });
+  }
+
+  SUBCASE("sessions further apart than the max window should never match") {
+    join(1, 1000);
+    join(2, 1500);
+
+    mm.match(games, messages, 0);
+    CHECK(!mm.can_match());
+    mm.match(games, messages, 60000);
+    CHECK(games.empty());
+    CHECK(mm.size() == 2);
+  }
+
+  SUBCASE("a leaving session should make its neighbors adjacent") {
+    join(1, 1000);
+    join(2, 1200);
+    join(3, 1040);
+    mm.on_leave(3);
+    join(4, 1800);
+
+    mm.match(games, messages, 0);
+    CHECK(games.empty());
+
+    mm.match(games, messages, 7000);
+    REQUIRE(games.size() == 1);
+    CHECK(players_of(games[0]) == vector<session_id>{ 1, 2 });
+    CHECK(mm.size() == 1);
+  }
+
+  SUBCASE("the cancel data should mark the session unmatched") {
+    CHECK(mm.get_cancel_data()["matched"] == false);
+  }
+}
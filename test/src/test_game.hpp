@@ -8,13 +8,17 @@ using json = nlohmann::json;
 
 #include <spdlog/spdlog.h>
 
+#include <atomic>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 #include <queue>
+#include <list>
 #include <functional>
 #include <tuple>
 #include <utility>
+#include <thread>
+#include <chrono>
 
 using std::vector;
 using std::unordered_map;
@@ -63,7 +67,7 @@ public:
   using player_id = player_traits::id::player_id;
   using message = std::pair<player_id, std::string>;
 
-  test_game(const json& data): m_done(false) {
+  test_game(const json& data): m_done(false), m_has_delta_request(false) {
     try {
       if(data.at("matched") == true) {
         m_valid = true;
@@ -89,6 +93,13 @@ public:
       long delta_time
     )
   {
+    // reports the time passed to the update following a slow one
+    if(m_has_delta_request) {
+      json temp = { { "type", "delta_time" }, { "delta_time", delta_time } };
+      out_msg_list.emplace_back(m_delta_request_pid, temp.dump());
+      m_has_delta_request = false;
+    }
+
     for(const message& msg : in_msg_list) {
       try {
         json msg_json = json::parse(msg.second);
@@ -103,6 +114,12 @@ public:
           out_msg_list.emplace_back(msg.first, msg.second);
         } else if(msg_json.at("type") == "stop") {
           m_done = true;
+        } else if(msg_json.at("type") == "sleep") {
+          std::this_thread::sleep_for(
+              std::chrono::milliseconds{ msg_json.at("duration").get<long>() }
+            );
+          m_has_delta_request = true;
+          m_delta_request_pid = msg.first;
         } else {
           spdlog::error("client sent message without type: {}", msg.second);
         }
@@ -132,9 +149,22 @@ public:
     return data;
   }
 
+  // players reconnect to a restored game, so only the game state is kept
+  json get_snapshot() const {
+    json snapshot;
+    snapshot["done"] = m_done;
+    return snapshot;
+  }
+
+  void restore(const json& snapshot) {
+    m_done = snapshot.at("done").get<bool>();
+  }
+
 private:
   unordered_set<player_id> m_player_list;
   bool m_done, m_valid;
+  bool m_has_delta_request;
+  player_id m_delta_request_pid;
 };
 
 class test_matchmaker {
@@ -192,4 +222,71 @@ private:
   session_id m_sid_count;
 };
 
+class test_incremental_matchmaker {
+public:
+  using player_traits = test_player_traits;
+  using session_id = player_traits::id::session_id;
+  using id_hash = player_traits::id::hash;
+  using message = std::pair<session_id, std::string>;
+  using game = std::tuple<std::vector<session_id>, session_id, json>;
+  using session_data = test_matchmaker::session_data;
+
+  bool can_match() const {
+    return m_queue.size() > 1;
+  }
+
+  void on_join(const session_id& sid, const session_data& data) {
+    m_queue_positions.emplace(sid, m_queue.insert(m_queue.end(), sid));
+  }
+
+  void on_leave(const session_id& sid) {
+    auto it = m_queue_positions.find(sid);
+    if(it != m_queue_positions.end()) {
+      m_queue.erase(it->second);
+      m_queue_positions.erase(it);
+    }
+  }
+
+  void match(
+      vector<game>& game_list,
+      vector<message>& messages,
+      long delta_time
+    )
+  {
+    while(m_queue.size() > 1) {
+      vector<session_id> sl;
+      for(std::size_t i = 0; i < 2; ++i) {
+        sl.push_back(m_queue.front());
+        m_queue_positions.erase(m_queue.front());
+        m_queue.pop_front();
+      }
+      game_list.emplace_back(
+          std::move(sl),
+          next_game_id(),
+          json{ { "matched", true } }
+        );
+    }
+  }
+
+  json get_cancel_data() const {
+    json temp;
+    temp["matched"] = false;
+    return temp;
+  }
+
+private:
+  // shared by all instances, so ids stay unique across a server's queues
+  static session_id next_game_id() {
+    static std::atomic<unsigned long> sid_count{ 0 };
+    return static_cast<session_id>(sid_count++);
+  }
+
+  std::list<session_id> m_queue;
+  unordered_map<
+      session_id,
+      std::list<session_id>::iterator,
+      id_hash
+    > m_queue_positions;
+};
+
 #endif // MINIMAL_GAME_HPP
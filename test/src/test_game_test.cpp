@@ -149,3 +149,52 @@ TEST_CASE("matchmaking data match function should pair players") {
     CHECK(matchmaker.can_match(session_map) == true);
   }
 }
+
+TEST_CASE("incremental matchmaker should pair sessions in the order they join") {
+  using std::vector;
+
+  using session_id = test_player_traits::id::session_id;
+  using session_data = test_incremental_matchmaker::session_data;
+  using game = test_incremental_matchmaker::game;
+  using message = test_incremental_matchmaker::message;
+
+  test_incremental_matchmaker matchmaker;
+  vector<message> messages;
+  vector<game> games;
+
+  SUBCASE("an empty queue should return an empty list of games") {
+    CHECK(matchmaker.can_match() == false);
+
+    matchmaker.match(games, messages, 0);
+
+    CHECK(games.size() == 0);
+  }
+
+  SUBCASE("five joined sessions should return two games in join order") {
+    for(session_id sid : { 7, 12, 712, 2, 82 }) {
+      matchmaker.on_join(sid, session_data{json{}});
+    }
+
+    CHECK(matchmaker.can_match() == true);
+
+    matchmaker.match(games, messages, 0);
+
+    CHECK(games.size() == 2);
+    CHECK(std::get<0>(games[0]) == vector<session_id>{ 7, 12 });
+    CHECK(std::get<0>(games[1]) == vector<session_id>{ 712, 2 });
+    CHECK(matchmaker.can_match() == false);
+  }
+
+  SUBCASE("sessions that leave should not be matched") {
+    for(session_id sid : { 3, 4, 5 }) {
+      matchmaker.on_join(sid, session_data{json{}});
+    }
+    matchmaker.on_leave(4);
+    matchmaker.on_leave(9000);
+
+    matchmaker.match(games, messages, 0);
+
+    CHECK(games.size() == 1);
+    CHECK(std::get<0>(games[0]) == vector<session_id>{ 3, 5 });
+  }
+}
@@ -0,0 +1,431 @@
+// Generates load against a game_server or matchmaking_server.
+//
+// Mints a JWT for each simulated player with a local secret, ramps up
+// connections at a fixed rate on a client_pool, and then either sends game
+// inputs at a fixed rate per player (game mode) or waits for each player's
+// matchmaking result (matchmaking mode). Every player also pings the server
+// periodically. Runs entirely against the given URI, typically localhost,
+// and reports connect latency, ping round trip time, time to match,
+// message throughput, and errors.
+//
+// See README.md for the options.
+
+#define DISABLE_PICOJSON
+#include <jwt-cpp/jwt.h>
+
+#include <simple_web_game_server/client_pool.hpp>
+#include <simple_web_game_server/latency_histogram.hpp>
+
+#include <json_traits/nlohmann_traits.hpp>
+#include <websocketpp_configs/asio_client_no_logs.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using claim = jwt::basic_claim<nlohmann_traits>;
+using pool_type = simple_web_game_server::client_pool<asio_client_no_logs>;
+using simple_web_game_server::latency_histogram;
+using clock_type = std::chrono::steady_clock;
+
+struct options {
+  std::string uri = "ws://localhost:9090";
+  std::string mode = "game";
+  std::string secret = "secret";
+  std::string issuer;
+  std::string script;
+  json data = json::object();
+  std::size_t players = 1000;
+  std::size_t session_size = 2;
+  std::size_t threads = 2;
+  double connect_rate = 200;
+  double input_rate = 10;
+  long duration = 30;
+  long ping_interval = 1000;
+  unsigned long first_id = 0;
+};
+
+void print_usage() {
+  std::printf(
+      "usage: load_generator [--option=value ...]\n"
+      "  --uri=ws://localhost:9090  server to connect to\n"
+      "  --mode=game                game or matchmaking\n"
+      "  --players=1000             number of simulated players\n"
+      "  --connect-rate=200         new connections per second\n"
+      "  --duration=30              seconds to run after the ramp up\n"
+      "  --threads=2                client threads\n"
+      "  --session-size=2           players per session in game mode\n"
+      "  --input-rate=10            inputs per player per second in game mode\n"
+      "  --script=FILE              replay the lines of FILE as inputs\n"
+      "  --ping-interval=1000       milliseconds between pings\n"
+      "  --secret=secret            HS256 secret used to sign tokens\n"
+      "  --issuer=...               token issuer, by default\n"
+      "                             matchmaking_server in game mode and\n"
+      "                             auth_server in matchmaking mode\n"
+      "  --data={}                  JSON data claim of each token\n"
+      "  --first-id=0               first player and session id\n"
+    );
+}
+
+options parse_options(int argc, char** argv) {
+  options opts;
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if(arg == "--help") {
+      print_usage();
+      std::exit(0);
+    }
+    const std::size_t eq = arg.find('=');
+    if(arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+      throw std::invalid_argument{"unrecognized argument " + arg};
+    }
+    const std::string key = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+
+    if(key == "uri") {
+      opts.uri = value;
+    } else if(key == "mode") {
+      opts.mode = value;
+    } else if(key == "secret") {
+      opts.secret = value;
+    } else if(key == "issuer") {
+      opts.issuer = value;
+    } else if(key == "script") {
+      opts.script = value;
+    } else if(key == "data") {
+      opts.data = json::parse(value);
+    } else if(key == "players") {
+      opts.players = std::stoul(value);
+    } else if(key == "session-size") {
+      opts.session_size = std::stoul(value);
+    } else if(key == "threads") {
+      opts.threads = std::stoul(value);
+    } else if(key == "connect-rate") {
+      opts.connect_rate = std::stod(value);
+    } else if(key == "input-rate") {
+      opts.input_rate = std::stod(value);
+    } else if(key == "duration") {
+      opts.duration = std::stol(value);
+    } else if(key == "ping-interval") {
+      opts.ping_interval = std::stol(value);
+    } else if(key == "first-id") {
+      opts.first_id = std::stoul(value);
+    } else {
+      throw std::invalid_argument{"unknown option --" + key};
+    }
+  }
+
+  if(opts.mode != "game" && opts.mode != "matchmaking") {
+    throw std::invalid_argument{"mode must be game or matchmaking"};
+  }
+  if(opts.issuer.empty()) {
+    opts.issuer = opts.mode == "game" ? "matchmaking_server" : "auth_server";
+  }
+  if(opts.session_size == 0 || opts.threads == 0 || opts.connect_rate <= 0) {
+    throw std::invalid_argument{
+        "session-size, threads, and connect-rate must be positive"
+      };
+  }
+  return opts;
+}
+
+long long now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      clock_type::now().time_since_epoch()
+    ).count();
+}
+
+// the state of one simulated player, written by the pool's threads
+struct player {
+  std::atomic<long long> connect_time{ 0 };
+  std::atomic<bool> is_open{ false };
+  std::atomic<bool> is_done{ false };
+  std::size_t next_input = 0;
+  long long next_input_time = 0;
+  long long next_ping_time = 0;
+};
+
+struct counters {
+  std::atomic<std::size_t> opened{ 0 };
+  std::atomic<std::size_t> failed{ 0 };
+  std::atomic<std::size_t> dropped{ 0 };
+  std::atomic<std::size_t> matched{ 0 };
+  std::atomic<std::size_t> cancelled{ 0 };
+  std::atomic<std::size_t> sent{ 0 };
+  std::atomic<std::size_t> received{ 0 };
+  std::atomic<std::size_t> send_errors{ 0 };
+};
+
+// players still queued when the run ended
+std::size_t pool_waiting(const counters& count) {
+  const std::size_t done = count.matched + count.cancelled + count.dropped;
+  return count.opened > done ? count.opened - done : 0;
+}
+
+void print_histogram(const char* name, const latency_histogram& h) {
+  std::printf(
+      "%-13s n=%-8llu p50=%9.2fms p90=%9.2fms p99=%9.2fms max=%9.2fms\n",
+      name,
+      static_cast<unsigned long long>(h.count()),
+      h.percentile(50).count() / 1000.0,
+      h.percentile(90).count() / 1000.0,
+      h.percentile(99).count() / 1000.0,
+      h.max().count() / 1000.0
+    );
+}
+
+int main(int argc, char** argv) {
+  options opts;
+  try {
+    opts = parse_options(argc, argv);
+  } catch(std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    print_usage();
+    return 1;
+  }
+
+  spdlog::set_level(spdlog::level::warn);
+
+  std::vector<std::string> script;
+  if(!opts.script.empty()) {
+    std::ifstream file(opts.script);
+    for(std::string line; std::getline(file, line); ) {
+      if(!line.empty()) {
+        script.push_back(line);
+      }
+    }
+    if(script.empty()) {
+      std::fprintf(stderr, "no inputs in script %s\n", opts.script.c_str());
+      return 1;
+    }
+  }
+
+  const bool is_game = opts.mode == "game";
+  std::vector<std::unique_ptr<player> > players;
+  for(std::size_t i = 0; i < opts.players; ++i) {
+    players.emplace_back(new player);
+  }
+
+  counters count;
+  latency_histogram connect_times;
+  latency_histogram ping_times;
+  latency_histogram match_times;
+  std::atomic<bool> is_stopping{ false };
+
+  pool_type pool;
+  pool.set_pong_handler(
+      [&](pool_type::connection_id, const std::string& payload) {
+        try {
+          ping_times.record(
+              std::chrono::microseconds{ now_us() - std::stoll(payload) }
+            );
+        } catch(std::exception& e) {
+          ++count.send_errors;
+        }
+      }
+    );
+  std::thread pool_thread{ [&]() { pool.run(opts.threads); } };
+
+  std::printf(
+      "%s mode: %zu players at %.0f/s to %s\n",
+      opts.mode.c_str(),
+      opts.players,
+      opts.connect_rate,
+      opts.uri.c_str()
+    );
+
+  // minting tokens is not free, so it is done before the clock starts
+  std::vector<std::string> tokens;
+  for(std::size_t i = 0; i < opts.players; ++i) {
+    const unsigned long pid = opts.first_id + i;
+    const unsigned long sid = is_game
+      ? opts.first_id + i / opts.session_size
+      : pid;
+    tokens.push_back(jwt::create<nlohmann_traits>()
+        .set_issuer(opts.issuer)
+        .set_payload_claim("pid", claim(pid))
+        .set_payload_claim("sid", claim(sid))
+        .set_payload_claim("data", claim(opts.data))
+        .sign(jwt::algorithm::hs256{opts.secret})
+      );
+  }
+
+  std::mt19937_64 rng{ 12345 };
+  std::uniform_int_distribution<int> input_dist{ 0, 8 };
+  const long long input_period = opts.input_rate > 0
+    ? static_cast<long long>(1000000.0 / opts.input_rate)
+    : 0;
+  const long long ping_period = opts.ping_interval * 1000LL;
+
+  const long long start = now_us();
+  const long long ramp_end = start
+    + static_cast<long long>(1000000.0 * opts.players / opts.connect_rate);
+  const long long end = ramp_end + opts.duration * 1000000LL;
+  std::size_t connected = 0;
+  long long next_report = start + 1000000;
+  std::size_t last_sent = 0;
+  std::size_t last_received = 0;
+
+  while(now_us() < end) {
+    const long long now = now_us();
+
+    // ramp up: open every connection whose start time has passed
+    while(connected < opts.players
+        && start + static_cast<long long>(
+          1000000.0 * connected / opts.connect_rate
+        ) <= now)
+    {
+      player& p = *players[connected];
+      p.connect_time = now_us();
+      p.next_input_time = now + input_period;
+      p.next_ping_time = now + ping_period;
+      pool.connect(
+          opts.uri,
+          tokens[connected],
+          [&p, &count, &connect_times]() {
+            connect_times.record(
+                std::chrono::microseconds{ now_us() - p.connect_time }
+              );
+            p.is_open = true;
+            ++count.opened;
+          },
+          [&p, &count, &is_stopping]() {
+            if(!p.is_open) {
+              ++count.failed;
+            } else if(!p.is_done && !is_stopping) {
+              ++count.dropped;
+            }
+            p.is_open = false;
+          },
+          [&p, &count, &match_times, is_game](const std::string& msg) {
+            ++count.received;
+            if(is_game || p.is_done) {
+              return;
+            }
+            // a matchmaking result is a token, sent bare or wrapped in JSON
+            // by the sign function, and status messages are JSON
+            std::string token = msg;
+            if(!msg.empty() && msg.front() == '{') {
+              json msg_json = json::parse(msg, nullptr, false);
+              if(msg_json.is_discarded()
+                || msg_json.value("type", "") == "queue_status"
+                || !msg_json.contains("token")
+                || !msg_json["token"].is_string())
+              {
+                return;
+              }
+              token = msg_json["token"].get<std::string>();
+            }
+            p.is_done = true;
+            match_times.record(
+                std::chrono::microseconds{ now_us() - p.connect_time }
+              );
+            try {
+              json result = jwt::decode<nlohmann_traits>(token)
+                .get_payload_claim("data").to_json();
+              if(result.value("matched", true)) {
+                ++count.matched;
+              } else {
+                ++count.cancelled;
+              }
+            } catch(std::exception& e) {
+              ++count.matched;
+            }
+          }
+        );
+      ++connected;
+    }
+
+    for(std::size_t i = 0; i < connected; ++i) {
+      player& p = *players[i];
+      if(!p.is_open) {
+        continue;
+      }
+      try {
+        if(is_game && input_period > 0 && p.next_input_time <= now) {
+          std::string input;
+          if(script.empty()) {
+            json msg;
+            msg["seq"] = p.next_input;
+            msg["move"] = input_dist(rng);
+            input = msg.dump();
+          } else {
+            input = script[p.next_input % script.size()];
+          }
+          pool.send(i, input);
+          ++p.next_input;
+          p.next_input_time += input_period;
+          ++count.sent;
+        }
+        if(ping_period > 0 && p.next_ping_time <= now) {
+          pool.ping(i, std::to_string(now_us()));
+          p.next_ping_time += ping_period;
+        }
+      } catch(pool_type::client_error& e) {
+        // the connection closed since it was checked
+        ++count.send_errors;
+      }
+    }
+
+    if(now >= next_report) {
+      const std::size_t sent = count.sent;
+      const std::size_t received = count.received;
+      std::printf(
+          "[%5.1fs] open %zu, sent %zu/s, received %zu/s, ping p50 %.2fms\n",
+          (now - start) / 1000000.0,
+          pool.get_open_count(),
+          sent - last_sent,
+          received - last_received,
+          ping_times.percentile(50).count() / 1000.0
+        );
+      last_sent = sent;
+      last_received = received;
+      next_report += 1000000;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+  }
+
+  is_stopping = true;
+  const double seconds = (now_us() - start) / 1000000.0;
+  pool.stop();
+  pool_thread.join();
+
+  std::printf("\nran %.1fs with %zu players\n", seconds, opts.players);
+  print_histogram("connect", connect_times);
+  print_histogram("ping rtt", ping_times);
+  if(!is_game) {
+    print_histogram("time to match", match_times);
+    std::printf(
+        "matched %zu, cancelled %zu, waiting %zu\n",
+        count.matched.load(),
+        count.cancelled.load(),
+        pool_waiting(count)
+      );
+  }
+  std::printf(
+      "throughput: sent %.0f msg/s, received %.0f msg/s\n",
+      count.sent / seconds,
+      count.received / seconds
+    );
+  std::printf(
+      "errors: %zu failed connections, %zu dropped connections, "
+      "%zu failed sends\n",
+      count.failed.load(),
+      count.dropped.load(),
+      count.send_errors.load()
+    );
+
+  return count.failed + count.dropped > 0 ? 2 : 0;
+}